@@ -1,8 +1,11 @@
 #include "gpio.h"
 
-#include <linux/delay.h>
+#include <linux/fs.h>
 #include <linux/hrtimer.h>
 #include <linux/interrupt.h>
+#include <linux/math64.h>
+#include <linux/poll.h>
+#include <linux/uaccess.h>
 
 #include "../utils/utils.h"
 
@@ -61,19 +64,21 @@ static int mkstrtobool(const char *s, bool *res) {
 }
 
 static void debounceTimerRestart(struct DebouncedGpioBean *deb) {
-  unsigned long debTime_usec;
-
-  if (gpioGetVal(&deb->gpio)) {
-    debTime_usec = deb->onMinTime_usec;
-  } else {
-    debTime_usec = deb->offMinTime_usec;
-  }
+  unsigned long flags;
 
   hrtimer_cancel(&deb->timer);
-  hrtimer_start(&deb->timer, ktime_set(0, debTime_usec * 1000),
-                HRTIMER_MODE_REL);
+  spin_lock_irqsave(&deb->lock, flags);
+  deb->lastEdge = ktime_get();
+  deb->timerArmed = true;
+  hrtimer_start(&deb->timer, ktime_set(0, 0), HRTIMER_MODE_REL);
+  spin_unlock_irqrestore(&deb->lock, flags);
 }
 
+/**
+ * Only timestamps the edge. The timer is armed on the first edge of a burst
+ * and evaluates the line lazily, so a chattering input costs one timer
+ * expiration per debounce period at most.
+ */
 static irqreturn_t debounceIrqHandler(int irq, void *dev) {
   struct DebouncedGpioBean *deb;
   deb = (struct DebouncedGpioBean *)dev;
@@ -81,19 +86,75 @@ static irqreturn_t debounceIrqHandler(int irq, void *dev) {
     // should never happen
     return IRQ_HANDLED;
   }
-  debounceTimerRestart(deb);
+  spin_lock(&deb->lock);
+  deb->lastEdge = ktime_get();
+  deb->rawCnt++;
+  if (!deb->timerArmed) {
+    deb->timerArmed = true;
+    hrtimer_start(&deb->timer,
+                  ns_to_ktime(min(deb->onMinTime_usec, deb->offMinTime_usec) *
+                              1000),
+                  HRTIMER_MODE_REL);
+  }
+  spin_unlock(&deb->lock);
   return IRQ_HANDLED;
 }
 
+/**
+ * Queues a settled transition. Called from the debounce timer only, which is
+ * the single producer, so head is published without locking.
+ */
+static void debounceEventPush(struct DebouncedGpioBean *deb, ktime_t ts,
+                              int val) {
+  struct DebouncedGpioEventsBean *e = &deb->events;
+  struct DebouncedGpioEvent *rec;
+  unsigned int head;
+
+  head = e->head;
+  if (head - smp_load_acquire(&e->tail) >= DEBOUNCE_EVENTS_RING_SIZE) {
+    e->lost++;
+  } else {
+    rec = &e->ring[head % DEBOUNCE_EVENTS_RING_SIZE];
+    rec->timestamp_ns = ktime_to_ns(ts);
+    if (e->lastTs == 0) {
+      rec->width_us = 0;
+    } else {
+      rec->width_us = (uint32_t)min_t(s64, ktime_us_delta(ts, e->lastTs),
+                                      U32_MAX);
+    }
+    rec->value = val;
+    smp_store_release(&e->head, head + 1);
+  }
+  e->lastTs = ts;
+  wake_up_interruptible(&e->wq);
+}
+
 static enum hrtimer_restart debounceTimerHandler(struct hrtimer *tmr) {
   struct DebouncedGpioBean *deb;
+  unsigned long flags;
+  unsigned long debTime_usec;
+  ktime_t stableAt;
+  ktime_t edge;
   int val;
 
   deb = container_of(tmr, struct DebouncedGpioBean, timer);
   val = gpioGetVal(&deb->gpio);
+  debTime_usec = val ? deb->onMinTime_usec : deb->offMinTime_usec;
+
+  spin_lock_irqsave(&deb->lock, flags);
+  stableAt = ktime_add_us(deb->lastEdge, debTime_usec);
+  if (ktime_before(ktime_get(), stableAt)) {
+    hrtimer_set_expires(tmr, stableAt);
+    spin_unlock_irqrestore(&deb->lock, flags);
+    return HRTIMER_RESTART;
+  }
+  deb->timerArmed = false;
+  edge = deb->lastEdge;
+  spin_unlock_irqrestore(&deb->lock, flags);
 
   if (deb->value != val) {
     deb->value = val;
+    debounceEventPush(deb, edge, val);
     if (val) {
       deb->onCnt++;
     } else {
@@ -102,14 +163,156 @@ static enum hrtimer_restart debounceTimerHandler(struct hrtimer *tmr) {
     if (deb->notifKn != NULL) {
       sysfs_notify_dirent(deb->notifKn);
     }
+  } else {
+    deb->glitchCnt++;
   }
 
   return HRTIMER_NORESTART;
 }
 
+static void blinkSetVal(struct GpioBean *g, int val, bool cansleep) {
+  if (g->invert) {
+    val = val == 0 ? 1 : 0;
+  }
+  if (cansleep) {
+    gpiod_set_value_cansleep(g->desc, val);
+  } else {
+    gpiod_set_value(g->desc, val);
+  }
+}
+
+/**
+ * Advances the blink pattern by one phase.
+ * Returns the duration in ms of the new phase, 0 when the pattern is over.
+ */
+static unsigned long blinkStep(struct GpioBean *g, bool cansleep) {
+  struct GpioBlinkBean *b = &g->blink;
+
+  if (b->remaining == 0) {
+    return 0;
+  }
+  if (b->on) {
+    blinkSetVal(g, 0, cansleep);
+    b->on = false;
+    b->remaining--;
+    if (b->remaining == 0) {
+      return 0;
+    }
+    return b->offMs;
+  }
+  blinkSetVal(g, 1, cansleep);
+  b->on = true;
+  return b->onMs;
+}
+
+static enum hrtimer_restart blinkTimerHandler(struct hrtimer *tmr) {
+  struct GpioBean *g;
+  unsigned long next;
+
+  g = container_of(tmr, struct GpioBean, blink.timer);
+  next = blinkStep(g, false);
+  if (next == 0) {
+    return HRTIMER_NORESTART;
+  }
+  hrtimer_forward_now(tmr, ms_to_ktime(next));
+  return HRTIMER_RESTART;
+}
+
+static void blinkWorkHandler(struct work_struct *work) {
+  struct GpioBean *g;
+  unsigned long next;
+
+  g = container_of(to_delayed_work(work), struct GpioBean, blink.work);
+  next = blinkStep(g, true);
+  if (next > 0) {
+    schedule_delayed_work(&g->blink.work, msecs_to_jiffies(next));
+  }
+}
+
+/**
+ * Both edges are timestamped here; a full period is accounted on each rising
+ * edge following a falling one. An edge reading the same level as the
+ * previous one means an edge was missed, and the period in progress is
+ * discarded.
+ */
+static irqreturn_t captureIrqHandler(int irq, void *dev) {
+  struct CaptureGpioBean *c;
+  ktime_t now;
+  int val;
+
+  now = ktime_get();
+  c = (struct CaptureGpioBean *)dev;
+  if (c->irq != irq) {
+    // should never happen
+    return IRQ_HANDLED;
+  }
+  val = gpioGetVal(&c->gpio);
+
+  spin_lock(&c->lock);
+  if (val == c->level) {
+    c->lastRise = 0;
+    c->lastFall = 0;
+  } else if (val) {
+    if (c->lastRise != 0 && c->lastFall != 0 &&
+        ktime_after(c->lastFall, c->lastRise)) {
+      c->sumPeriod_ns += ktime_to_ns(ktime_sub(now, c->lastRise));
+      c->sumHigh_ns += ktime_to_ns(ktime_sub(c->lastFall, c->lastRise));
+      c->periods++;
+    }
+    c->lastRise = now;
+  } else {
+    c->lastFall = now;
+  }
+  c->level = val;
+  spin_unlock(&c->lock);
+
+  return IRQ_HANDLED;
+}
+
+static enum hrtimer_restart captureTimerHandler(struct hrtimer *tmr) {
+  struct CaptureGpioBean *c;
+  unsigned long flags;
+  uint64_t sumPeriod, sumHigh;
+  unsigned long periods;
+
+  c = container_of(tmr, struct CaptureGpioBean, timer);
+
+  spin_lock_irqsave(&c->lock, flags);
+  sumPeriod = c->sumPeriod_ns;
+  sumHigh = c->sumHigh_ns;
+  periods = c->periods;
+  c->sumPeriod_ns = 0;
+  c->sumHigh_ns = 0;
+  c->periods = 0;
+  spin_unlock_irqrestore(&c->lock, flags);
+
+  if (periods == 0 || sumPeriod == 0) {
+    c->period_ns = 0;
+    c->freq_mHz = 0;
+    c->duty = 0;
+  } else {
+    c->period_ns = div64_u64(sumPeriod, periods);
+    c->freq_mHz = div64_u64(periods * 1000000000000ull, sumPeriod);
+    c->duty = (unsigned int)div64_u64(sumHigh * 1000, sumPeriod);
+  }
+
+  hrtimer_forward_now(tmr, ms_to_ktime(c->window_ms));
+  return HRTIMER_RESTART;
+}
+
 void gpioSetPlatformDev(struct platform_device *pdev) { _pdev = pdev; }
 
 int gpioInit(struct GpioBean *g) {
+  g->blink.remaining = 0;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 15, 0)
+  hrtimer_setup(&g->blink.timer, blinkTimerHandler, CLOCK_MONOTONIC,
+                HRTIMER_MODE_REL);
+#else
+  hrtimer_init(&g->blink.timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+  g->blink.timer.function = &blinkTimerHandler;
+#endif
+  INIT_DELAYED_WORK(&g->blink.work, blinkWorkHandler);
+
   g->desc = gpiod_get(&_pdev->dev, g->name, g->flags);
   return IS_ERR(g->desc);
 }
@@ -128,6 +331,16 @@ int gpioInitDebounce(struct DebouncedGpioBean *d) {
   d->offMinTime_usec = DEBOUNCE_DEFAULT_TIME_USEC;
   d->onCnt = 0;
   d->offCnt = 0;
+  d->rawCnt = 0;
+  d->glitchCnt = 0;
+  d->timerArmed = false;
+  spin_lock_init(&d->lock);
+  d->events.head = 0;
+  d->events.tail = 0;
+  d->events.lost = 0;
+  d->events.lastTs = 0;
+  mutex_init(&d->events.readLock);
+  init_waitqueue_head(&d->events.wq);
 
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 15, 0)
   hrtimer_setup(&d->timer, debounceTimerHandler, CLOCK_MONOTONIC,
@@ -151,14 +364,110 @@ int gpioInitDebounce(struct DebouncedGpioBean *d) {
   return res;
 }
 
+void gpioSetupCapture(struct CaptureGpioBean *c) {
+  mutex_init(&c->cfgLock);
+  spin_lock_init(&c->lock);
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 15, 0)
+  hrtimer_setup(&c->timer, captureTimerHandler, CLOCK_MONOTONIC,
+                HRTIMER_MODE_REL);
+#else
+  hrtimer_init(&c->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+  c->timer.function = &captureTimerHandler;
+#endif
+  c->irqRequested = false;
+  c->descOwned = false;
+}
+
+static void captureStop(struct CaptureGpioBean *c) {
+  if (c->irqRequested) {
+    free_irq(c->irq, c);
+    hrtimer_cancel(&c->timer);
+    c->irqRequested = false;
+  }
+  if (c->descOwned) {
+    gpioFree(&c->gpio);
+    c->descOwned = false;
+  }
+}
+
+static int captureStart(struct CaptureGpioBean *c) {
+  int res;
+
+  if (c->gpio.desc == NULL) {
+    c->gpio.flags = GPIOD_IN;
+    if (gpioInit(&c->gpio)) {
+      // e.g. -EBUSY if the line is requested by someone else
+      res = PTR_ERR(c->gpio.desc);
+      c->gpio.desc = NULL;
+      return res;
+    }
+    c->descOwned = true;
+  } else {
+    // borrowed line: only captured if already an input
+    res = gpiod_get_direction(c->gpio.desc);
+    if (res < 0) {
+      return res;
+    }
+    if (res == 0) {
+      return -EBUSY;
+    }
+  }
+
+  if (c->window_ms < CAPTURE_MIN_WINDOW_MSEC) {
+    c->window_ms = CAPTURE_DEFAULT_WINDOW_MSEC;
+  }
+  c->level = gpioGetVal(&c->gpio);
+  c->lastRise = 0;
+  c->lastFall = 0;
+  c->sumPeriod_ns = 0;
+  c->sumHigh_ns = 0;
+  c->periods = 0;
+  c->period_ns = 0;
+  c->freq_mHz = 0;
+  c->duty = 0;
+
+  c->irq = gpiod_to_irq(c->gpio.desc);
+  res = request_irq(c->irq, captureIrqHandler,
+                    (IRQF_TRIGGER_RISING | IRQF_TRIGGER_FALLING), c->gpio.name,
+                    c);
+  if (res) {
+    captureStop(c);
+    return res;
+  }
+  c->irqRequested = true;
+
+  hrtimer_start(&c->timer, ms_to_ktime(c->window_ms), HRTIMER_MODE_REL);
+
+  return 0;
+}
+
+int gpioInitCapture(struct CaptureGpioBean *c) {
+  int res = 0;
+
+  mutex_lock(&c->cfgLock);
+  if (!c->irqRequested) {
+    res = captureStart(c);
+  }
+  mutex_unlock(&c->cfgLock);
+  return res;
+}
+
+void gpioFreeCapture(struct CaptureGpioBean *c) {
+  mutex_lock(&c->cfgLock);
+  captureStop(c);
+  mutex_unlock(&c->cfgLock);
+}
+
 void gpioFree(struct GpioBean *g) {
   if (g->desc != NULL && !IS_ERR(g->desc)) {
+    gpioBlinkStop(g);
     gpiod_put(g->desc);
     g->desc = NULL;
   }
 }
 
 void gpioFreeDebounce(struct DebouncedGpioBean *d) {
+  gpioDebEventsUnregister(d);
   gpioFree(&d->gpio);
   if (d->irqRequested) {
     free_irq(d->irq, d);
@@ -167,6 +476,101 @@ void gpioFreeDebounce(struct DebouncedGpioBean *d) {
   }
 }
 
+static struct DebouncedGpioBean *debEventsGetBean(struct file *file) {
+  struct miscdevice *misc = file->private_data;
+  return container_of(misc, struct DebouncedGpioBean, events.misc);
+}
+
+static int debEventsOpen(struct inode *inode, struct file *file) {
+  return nonseekable_open(inode, file);
+}
+
+static ssize_t debEventsRead(struct file *file, char __user *buf,
+                             size_t count, loff_t *ppos) {
+  struct DebouncedGpioBean *d = debEventsGetBean(file);
+  struct DebouncedGpioEventsBean *e = &d->events;
+  struct DebouncedGpioEvent rec;
+  unsigned int tail;
+  ssize_t done = 0;
+  int ret;
+
+  if (count < sizeof(rec)) {
+    return -EINVAL;
+  }
+
+  if (mutex_lock_interruptible(&e->readLock)) {
+    return -ERESTARTSYS;
+  }
+
+  tail = e->tail;
+  if (smp_load_acquire(&e->head) == tail) {
+    if (file->f_flags & O_NONBLOCK) {
+      mutex_unlock(&e->readLock);
+      return -EAGAIN;
+    }
+    ret = wait_event_interruptible(e->wq, smp_load_acquire(&e->head) != tail);
+    if (ret < 0) {
+      mutex_unlock(&e->readLock);
+      return ret;
+    }
+  }
+
+  while (count - done >= sizeof(rec) && smp_load_acquire(&e->head) != tail) {
+    rec = e->ring[tail % DEBOUNCE_EVENTS_RING_SIZE];
+    if (copy_to_user(buf + done, &rec, sizeof(rec))) {
+      if (done == 0) {
+        done = -EFAULT;
+      }
+      break;
+    }
+    tail++;
+    smp_store_release(&e->tail, tail);
+    done += sizeof(rec);
+  }
+
+  mutex_unlock(&e->readLock);
+  return done;
+}
+
+static __poll_t debEventsPoll(struct file *file,
+                              struct poll_table_struct *wait) {
+  struct DebouncedGpioBean *d = debEventsGetBean(file);
+  poll_wait(file, &d->events.wq, wait);
+  if (smp_load_acquire(&d->events.head) != READ_ONCE(d->events.tail)) {
+    return EPOLLIN | EPOLLRDNORM;
+  }
+  return 0;
+}
+
+static const struct file_operations debEventsFops = {
+    .owner = THIS_MODULE,
+    .open = debEventsOpen,
+    .read = debEventsRead,
+    .poll = debEventsPoll,
+};
+
+int gpioDebEventsRegister(struct DebouncedGpioBean *d, const char *devName) {
+  int res;
+
+  d->events.misc.minor = MISC_DYNAMIC_MINOR;
+  d->events.misc.name = devName;
+  d->events.misc.fops = &debEventsFops;
+  d->events.misc.mode = 0440;
+  res = misc_register(&d->events.misc);
+  if (res) {
+    return res;
+  }
+  d->events.registered = true;
+  return 0;
+}
+
+void gpioDebEventsUnregister(struct DebouncedGpioBean *d) {
+  if (d->events.registered) {
+    misc_deregister(&d->events.misc);
+    d->events.registered = false;
+  }
+}
+
 int gpioGetVal(struct GpioBean *g) {
   int v;
   v = gpiod_get_value(g->desc);
@@ -183,6 +587,41 @@ void gpioSetVal(struct GpioBean *g, int val) {
   gpiod_set_value(g->desc, val);
 }
 
+void gpioBlinkStop(struct GpioBean *g) {
+  hrtimer_cancel(&g->blink.timer);
+  cancel_delayed_work_sync(&g->blink.work);
+  g->blink.remaining = 0;
+}
+
+int gpioArrayInit(struct GpioArrayBean *a) {
+  a->descs = gpiod_get_array(&_pdev->dev, a->name, a->flags);
+  if (IS_ERR(a->descs)) {
+    return 1;
+  }
+  if (a->descs->ndescs > BITS_PER_LONG) {
+    gpioArrayFree(a);
+    return 1;
+  }
+  return 0;
+}
+
+void gpioArrayFree(struct GpioArrayBean *a) {
+  if (a->descs != NULL && !IS_ERR(a->descs)) {
+    gpiod_put_array(a->descs);
+  }
+  a->descs = NULL;
+}
+
+int gpioArrayGetVal(struct GpioArrayBean *a, unsigned long *bits) {
+  return gpiod_get_array_value_cansleep(a->descs->ndescs, a->descs->desc,
+                                        a->descs->info, bits);
+}
+
+int gpioArraySetVal(struct GpioArrayBean *a, unsigned long *bits) {
+  return gpiod_set_array_value_cansleep(a->descs->ndescs, a->descs->desc,
+                                        a->descs->info, bits);
+}
+
 ssize_t devAttrGpioMode_show(struct device *dev, struct device_attribute *attr,
                              char *buf) {
   struct GpioBean *g;
@@ -286,19 +725,89 @@ ssize_t devAttrGpio_store(struct device *dev, struct device_attribute *attr,
     }
   }
 
+  gpioBlinkStop(g);
   gpioSetVal(g, val);
   return count;
 }
 
+ssize_t devAttrGpioArray_show(struct device *dev,
+                              struct device_attribute *attr, char *buf) {
+  struct GpioArrayBean *a;
+  unsigned long bits = 0;
+  int res;
+  a = gpioGetArrayBean(dev, attr);
+  if (a == NULL) {
+    return -EFAULT;
+  }
+  if (a->descs == NULL) {
+    return -ENODEV;
+  }
+  res = gpioArrayGetVal(a, &bits);
+  if (res < 0) {
+    return res;
+  }
+  return sprintf(buf, "%lu\n", bits);
+}
+
+ssize_t devAttrGpioArray_store(struct device *dev,
+                               struct device_attribute *attr, const char *buf,
+                               size_t count) {
+  struct GpioArrayBean *a;
+  unsigned long bits;
+  int res;
+  a = gpioGetArrayBean(dev, attr);
+  if (a == NULL) {
+    return -EFAULT;
+  }
+  if (a->descs == NULL) {
+    return -ENODEV;
+  }
+  if (a->flags != GPIOD_OUT_HIGH && a->flags != GPIOD_OUT_LOW) {
+    return -EPERM;
+  }
+  res = kstrtoul(buf, 0, &bits);
+  if (res < 0) {
+    return res;
+  }
+  if (a->descs->ndescs < BITS_PER_LONG &&
+      bits >= (1ul << a->descs->ndescs)) {
+    return -EINVAL;
+  }
+  res = gpioArraySetVal(a, &bits);
+  if (res < 0) {
+    return res;
+  }
+  return count;
+}
+
+ssize_t devAttrGpioBlink_show(struct device *dev,
+                              struct device_attribute *attr, char *buf) {
+  struct GpioBean *g;
+  struct GpioBlinkBean *b;
+  const char *vals = NULL;
+  g = gpioGetBean(dev, attr, &vals);
+  if (g == NULL) {
+    return -EFAULT;
+  }
+  if (g->flags != GPIOD_OUT_HIGH && g->flags != GPIOD_OUT_LOW) {
+    return -EPERM;
+  }
+  b = &g->blink;
+  if (b->remaining == 0) {
+    return sprintf(buf, "0 0 0\n");
+  }
+  return sprintf(buf, "%lu %lu %lu\n", b->onMs, b->offMs, b->remaining);
+}
+
 ssize_t devAttrGpioBlink_store(struct device *dev,
                                struct device_attribute *attr, const char *buf,
                                size_t count) {
-  int i;
   long on = 0;
   long off = 0;
   long rep = 1;
   char *end = NULL;
   struct GpioBean *g;
+  struct GpioBlinkBean *b;
   const char *vals = NULL;
   g = gpioGetBean(dev, attr, &vals);
   if (g == NULL) {
@@ -317,15 +826,27 @@ ssize_t devAttrGpioBlink_store(struct device *dev,
   if (rep < 1) {
     rep = 1;
   }
-  if (on > 0) {
-    for (i = 0; i < rep; i++) {
-      gpioSetVal(g, 1);
-      msleep(on);
-      gpioSetVal(g, 0);
-      if (i < rep - 1) {
-        msleep(off);
-      }
-    }
+  if (off < 0) {
+    off = 0;
+  }
+
+  b = &g->blink;
+  gpioBlinkStop(g);
+  if (on <= 0) {
+    gpioSetVal(g, 0);
+    return count;
+  }
+
+  b->onMs = on;
+  b->offMs = off;
+  b->remaining = rep;
+  b->on = true;
+  b->cansleep = gpiod_cansleep(g->desc);
+  blinkSetVal(g, 1, b->cansleep);
+  if (b->cansleep) {
+    schedule_delayed_work(&b->work, msecs_to_jiffies(on));
+  } else {
+    hrtimer_start(&b->timer, ms_to_ktime(on), HRTIMER_MODE_REL);
   }
   return count;
 }
@@ -396,6 +917,8 @@ ssize_t devAttrGpioDebMsOn_store(struct device *dev,
   d->onMinTime_usec = val * 1000;
   d->onCnt = 0;
   d->offCnt = 0;
+  d->rawCnt = 0;
+  d->glitchCnt = 0;
   d->value = DEBOUNCE_STATE_NOT_DEFINED;
   debounceTimerRestart(d);
 
@@ -420,6 +943,8 @@ ssize_t devAttrGpioDebMsOff_store(struct device *dev,
   d->offMinTime_usec = val * 1000;
   d->onCnt = 0;
   d->offCnt = 0;
+  d->rawCnt = 0;
+  d->glitchCnt = 0;
   d->value = DEBOUNCE_STATE_NOT_DEFINED;
   debounceTimerRestart(d);
 
@@ -445,3 +970,154 @@ ssize_t devAttrGpioDebOffCnt_show(struct device *dev,
   }
   return sprintf(buf, "%lu\n", d->offCnt);
 }
+
+ssize_t devAttrGpioDebRawCnt_show(struct device *dev,
+                                  struct device_attribute *attr, char *buf) {
+  struct DebouncedGpioBean *d;
+  d = gpioGetDebouncedBean(dev, attr);
+  if (d == NULL) {
+    return -EFAULT;
+  }
+  return sprintf(buf, "%lu\n", d->rawCnt);
+}
+
+ssize_t devAttrGpioDebGlitchCnt_show(struct device *dev,
+                                     struct device_attribute *attr,
+                                     char *buf) {
+  struct DebouncedGpioBean *d;
+  d = gpioGetDebouncedBean(dev, attr);
+  if (d == NULL) {
+    return -EFAULT;
+  }
+  return sprintf(buf, "%lu\n", d->glitchCnt);
+}
+
+ssize_t devAttrGpioDebEventsLost_show(struct device *dev,
+                                      struct device_attribute *attr,
+                                      char *buf) {
+  struct DebouncedGpioBean *d;
+  d = gpioGetDebouncedBean(dev, attr);
+  if (d == NULL) {
+    return -EFAULT;
+  }
+  return sprintf(buf, "%lu\n", d->events.lost);
+}
+
+static struct CaptureGpioBean *gpioGetCaptureBean(struct device *dev,
+                                                  struct device_attribute *attr) {
+  struct GpioBean *g;
+  const char *vals = NULL;
+  g = gpioGetBean(dev, attr, &vals);
+  if (g == NULL) {
+    return NULL;
+  }
+  return container_of(g, struct CaptureGpioBean, gpio);
+}
+
+ssize_t devAttrGpioCap_show(struct device *dev, struct device_attribute *attr,
+                            char *buf) {
+  struct CaptureGpioBean *c;
+  c = gpioGetCaptureBean(dev, attr);
+  if (c == NULL) {
+    return -EFAULT;
+  }
+  return sprintf(buf, "%d\n", c->irqRequested ? 1 : 0);
+}
+
+ssize_t devAttrGpioCap_store(struct device *dev, struct device_attribute *attr,
+                             const char *buf, size_t count) {
+  struct CaptureGpioBean *c;
+  bool val;
+  int ret;
+
+  c = gpioGetCaptureBean(dev, attr);
+  if (c == NULL) {
+    return -EFAULT;
+  }
+  if (mkstrtobool(buf, &val) < 0) {
+    return -EINVAL;
+  }
+  if (val) {
+    ret = gpioInitCapture(c);
+    if (ret) {
+      return ret;
+    }
+  } else {
+    gpioFreeCapture(c);
+  }
+  return count;
+}
+
+ssize_t devAttrGpioCapWindow_show(struct device *dev,
+                                  struct device_attribute *attr, char *buf) {
+  struct CaptureGpioBean *c;
+  c = gpioGetCaptureBean(dev, attr);
+  if (c == NULL) {
+    return -EFAULT;
+  }
+  return sprintf(buf, "%lu\n", c->window_ms < CAPTURE_MIN_WINDOW_MSEC
+                                   ? CAPTURE_DEFAULT_WINDOW_MSEC
+                                   : c->window_ms);
+}
+
+ssize_t devAttrGpioCapWindow_store(struct device *dev,
+                                   struct device_attribute *attr,
+                                   const char *buf, size_t count) {
+  struct CaptureGpioBean *c;
+  unsigned int val;
+  int ret;
+
+  c = gpioGetCaptureBean(dev, attr);
+  if (c == NULL) {
+    return -EFAULT;
+  }
+  ret = kstrtouint(buf, 10, &val);
+  if (ret < 0) {
+    return ret;
+  }
+  if (val < CAPTURE_MIN_WINDOW_MSEC) {
+    return -EINVAL;
+  }
+  // applied from the next window
+  c->window_ms = val;
+  return count;
+}
+
+ssize_t devAttrGpioCapPeriod_show(struct device *dev,
+                                  struct device_attribute *attr, char *buf) {
+  struct CaptureGpioBean *c;
+  c = gpioGetCaptureBean(dev, attr);
+  if (c == NULL) {
+    return -EFAULT;
+  }
+  if (!c->irqRequested) {
+    return -ENODATA;
+  }
+  return sprintf(buf, "%llu\n", c->period_ns);
+}
+
+ssize_t devAttrGpioCapDuty_show(struct device *dev,
+                                struct device_attribute *attr, char *buf) {
+  struct CaptureGpioBean *c;
+  c = gpioGetCaptureBean(dev, attr);
+  if (c == NULL) {
+    return -EFAULT;
+  }
+  if (!c->irqRequested) {
+    return -ENODATA;
+  }
+  return sprintf(buf, "%u\n", c->duty);
+}
+
+ssize_t devAttrGpioCapFreq_show(struct device *dev,
+                                struct device_attribute *attr, char *buf) {
+  struct CaptureGpioBean *c;
+  c = gpioGetCaptureBean(dev, attr);
+  if (c == NULL) {
+    return -EFAULT;
+  }
+  if (!c->irqRequested) {
+    return -ENODATA;
+  }
+  return sprintf(buf, "%llu\n", c->freq_mHz);
+}
@@ -2,11 +2,56 @@
 #define _SL_GPIO_H
 
 #include <linux/gpio/consumer.h>
+#include <linux/hrtimer.h>
+#include <linux/miscdevice.h>
+#include <linux/mutex.h>
 #include <linux/platform_device.h>
+#include <linux/spinlock.h>
 #include <linux/version.h>
+#include <linux/wait.h>
+#include <linux/workqueue.h>
 
 #define DEBOUNCE_DEFAULT_TIME_USEC 50000ul
 #define DEBOUNCE_STATE_NOT_DEFINED -1
+#define DEBOUNCE_EVENTS_RING_SIZE 64
+#define CAPTURE_DEFAULT_WINDOW_MSEC 1000ul
+#define CAPTURE_MIN_WINDOW_MSEC 10ul
+
+struct GpioArrayBean {
+  const char *name;
+  struct gpio_descs *descs;
+  enum gpiod_flags flags;
+  void *owner;
+};
+
+struct DebouncedGpioEvent {
+  uint64_t timestamp_ns;
+  uint32_t width_us;
+  uint8_t value;
+  uint8_t reserved[3];
+} __packed;
+
+struct DebouncedGpioEventsBean {
+  struct DebouncedGpioEvent ring[DEBOUNCE_EVENTS_RING_SIZE];
+  unsigned int head;
+  unsigned int tail;
+  unsigned long lost;
+  ktime_t lastTs;
+  struct mutex readLock;
+  wait_queue_head_t wq;
+  struct miscdevice misc;
+  bool registered;
+};
+
+struct GpioBlinkBean {
+  unsigned long onMs;
+  unsigned long offMs;
+  unsigned long remaining;
+  bool on;
+  bool cansleep;
+  struct hrtimer timer;
+  struct delayed_work work;
+};
 
 struct GpioBean {
   const char *name;
@@ -14,6 +59,7 @@ struct GpioBean {
   enum gpiod_flags flags;
   bool invert;
   void *owner;
+  struct GpioBlinkBean blink;
 };
 
 struct DebouncedGpioBean {
@@ -25,8 +71,34 @@ struct DebouncedGpioBean {
   unsigned long offMinTime_usec;
   unsigned long onCnt;
   unsigned long offCnt;
+  unsigned long rawCnt;
+  unsigned long glitchCnt;
+  ktime_t lastEdge;
+  bool timerArmed;
+  spinlock_t lock;
   struct hrtimer timer;
   struct kernfs_node *notifKn;
+  struct DebouncedGpioEventsBean events;
+};
+
+struct CaptureGpioBean {
+  struct GpioBean gpio;
+  int irq;
+  bool irqRequested;
+  bool descOwned;
+  int level;
+  unsigned long window_ms;
+  ktime_t lastRise;
+  ktime_t lastFall;
+  uint64_t sumPeriod_ns;
+  uint64_t sumHigh_ns;
+  unsigned long periods;
+  uint64_t period_ns;
+  uint64_t freq_mHz;
+  unsigned int duty;
+  spinlock_t lock;
+  struct mutex cfgLock;
+  struct hrtimer timer;
 };
 
 void gpioSetPlatformDev(struct platform_device *pdev);
@@ -39,10 +111,30 @@ void gpioFree(struct GpioBean *g);
 
 void gpioFreeDebounce(struct DebouncedGpioBean *d);
 
+void gpioSetupCapture(struct CaptureGpioBean *c);
+
+int gpioInitCapture(struct CaptureGpioBean *c);
+
+void gpioFreeCapture(struct CaptureGpioBean *c);
+
+int gpioDebEventsRegister(struct DebouncedGpioBean *d, const char *devName);
+
+void gpioDebEventsUnregister(struct DebouncedGpioBean *d);
+
 int gpioGetVal(struct GpioBean *g);
 
 void gpioSetVal(struct GpioBean *g, int val);
 
+void gpioBlinkStop(struct GpioBean *g);
+
+int gpioArrayInit(struct GpioArrayBean *a);
+
+void gpioArrayFree(struct GpioArrayBean *a);
+
+int gpioArrayGetVal(struct GpioArrayBean *a, unsigned long *bits);
+
+int gpioArraySetVal(struct GpioArrayBean *a, unsigned long *bits);
+
 ssize_t devAttrGpioMode_show(struct device *dev, struct device_attribute *attr,
                              char *buf);
 
@@ -78,11 +170,57 @@ ssize_t devAttrGpioDebOnCnt_show(struct device *dev,
 ssize_t devAttrGpioDebOffCnt_show(struct device *dev,
                                   struct device_attribute *attr, char *buf);
 
+ssize_t devAttrGpioDebRawCnt_show(struct device *dev,
+                                  struct device_attribute *attr, char *buf);
+
+ssize_t devAttrGpioDebGlitchCnt_show(struct device *dev,
+                                     struct device_attribute *attr,
+                                     char *buf);
+
+ssize_t devAttrGpioDebEventsLost_show(struct device *dev,
+                                      struct device_attribute *attr,
+                                      char *buf);
+
+ssize_t devAttrGpioCap_show(struct device *dev, struct device_attribute *attr,
+                            char *buf);
+
+ssize_t devAttrGpioCap_store(struct device *dev, struct device_attribute *attr,
+                             const char *buf, size_t count);
+
+ssize_t devAttrGpioCapWindow_show(struct device *dev,
+                                  struct device_attribute *attr, char *buf);
+
+ssize_t devAttrGpioCapWindow_store(struct device *dev,
+                                   struct device_attribute *attr,
+                                   const char *buf, size_t count);
+
+ssize_t devAttrGpioCapPeriod_show(struct device *dev,
+                                  struct device_attribute *attr, char *buf);
+
+ssize_t devAttrGpioCapDuty_show(struct device *dev,
+                                struct device_attribute *attr, char *buf);
+
+ssize_t devAttrGpioCapFreq_show(struct device *dev,
+                                struct device_attribute *attr, char *buf);
+
+ssize_t devAttrGpioBlink_show(struct device *dev,
+                              struct device_attribute *attr, char *buf);
+
 ssize_t devAttrGpioBlink_store(struct device *dev,
                                struct device_attribute *attr, const char *buf,
                                size_t count);
 
+ssize_t devAttrGpioArray_show(struct device *dev,
+                              struct device_attribute *attr, char *buf);
+
+ssize_t devAttrGpioArray_store(struct device *dev,
+                               struct device_attribute *attr, const char *buf,
+                               size_t count);
+
 struct GpioBean *gpioGetBean(struct device *dev, struct device_attribute *attr,
                              const char **vals);
 
+struct GpioArrayBean *gpioGetArrayBean(struct device *dev,
+                                       struct device_attribute *attr);
+
 #endif
@@ -12,13 +12,41 @@
  *
  */
 
+#include <linux/async.h>
+#include <linux/bitops.h>
+#include <linux/completion.h>
 #include <linux/delay.h>
+#include <linux/fixp-arith.h>
+#include <linux/fs.h>
+#include <linux/gpio/driver.h>
+#include <linux/hrtimer.h>
+#include <linux/hwmon.h>
 #include <linux/i2c.h>
 #include <linux/init.h>
+#include <linux/input.h>
 #include <linux/kernel.h>
+#include <linux/kthread.h>
+#include <linux/leds.h>
+#include <linux/math64.h>
+#include <linux/miscdevice.h>
 #include <linux/module.h>
+#include <linux/mount.h>
+#include <linux/namei.h>
 #include <linux/of.h>
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 14, 0)
+#include <linux/panic_notifier.h>
+#endif
+#include <linux/poll.h>
+#include <linux/power_supply.h>
+#include <linux/reboot.h>
+#include <linux/sched.h>
+#include <linux/spinlock.h>
+#include <linux/thermal.h>
+#include <linux/uaccess.h>
 #include <linux/version.h>
+#include <linux/wait.h>
+#include <linux/watchdog.h>
+#include <linux/workqueue.h>
 
 #include "commons/atecc/atecc.h"
 #include "commons/gpio/gpio.h"
@@ -39,6 +67,96 @@
 
 #define LOG_TAG "stratopimax: "
 
+#define RP2_PROBE_TIMEOUT_MSEC 2500
+
+#define AIN_REG_VAL_START 8
+#define AIN_CHANNELS_NUM 10
+#define AIN_VAL_OVERRANGE 8388607
+#define AIN_VAL_UNDERRANGE -8388607
+#define AIN_VAL_ERROR -8388608
+
+#define AOUT_REG_VAL_START 6
+#define AOUT_CHANNELS_NUM 4
+#define AOUT_VAL_MAX_V 10417
+
+#define PID_PERIOD_MIN_USEC 500
+#define PID_PERIOD_MAX_USEC 1000000
+#define PID_PERIOD_DEFAULT_USEC 10000
+#define PID_GAIN_MAX 1000000
+
+#define AIN_ALARM_INTERVAL_MIN_MSEC 50
+#define AIN_ALARM_INTERVAL_DEFAULT_MSEC 100
+
+#define LM75A_REG_TEMP 0
+#define LM75A_REG_THYST 2
+#define LM75A_REG_TOS 3
+#define LM75A_MASK_TEMP 0xe0
+#define LM75A_MASK_THRESHOLD 0x80
+#define LM75A_TEMP_MIN -12800
+#define LM75A_TEMP_MAX 12750
+
+#define WDT_BIT_ENABLED (1 << 0)
+#define WDT_BIT_HEARTBEAT (1 << 2)
+#define WDT_BIT_EXPIRED (1 << 2)
+#define WDT_TIMEOUT_DEFAULT_SEC 60
+
+#define PWR_PANIC_BLINK_MSEC 100
+
+#define KHB_PERIOD_MIN_PCT 5
+#define KHB_PERIOD_MAX_PCT 90
+#define KHB_PERIOD_DEFAULT_PCT 25
+#define KHB_PERIOD_MIN_MSEC 100
+#define KHB_WQ_TIMEOUT_DEFAULT_SEC 10
+#define KHB_FS_PATH_LEN 128
+#define KHB_FAIL_KEEPALIVE (1 << 0)
+#define KHB_FAIL_WQ (1 << 1)
+#define KHB_FAIL_FS (1 << 2)
+
+#define FAN_INTERVAL_MIN_MSEC 100
+#define FAN_INTERVAL_DEFAULT_MSEC 1000
+#define FAN_CPU_OFFSET_DEFAULT 2000
+#define FAN_CPU_THERMAL_ZONE "cpu-thermal"
+#define FAN_TRIP_TEMP_DEFAULT 60000
+#define FAN_TRIP_HYST_DEFAULT 5000
+
+#define HWMON_INTERVAL_MIN_MSEC 100
+#define HWMON_INTERVAL_DEFAULT_MSEC 1000
+
+#define LED_BLINK_DEFAULT_MSEC 500
+
+#define BUTTON_INTERVAL_MIN_MSEC 10
+#define BUTTON_INTERVAL_DEFAULT_MSEC 50
+#define BUTTON_LONG_PRESS_DEFAULT_MSEC 2000
+#define BUTTON_MISSED_MAX 8
+
+#define ACCEL_LSB_PER_G 16384
+#define ACCEL_INTERVAL_MIN_MSEC 10
+#define ACCEL_INTERVAL_DEFAULT_MSEC 50
+#define ACCEL_SHOCK_MAX_MG 4000
+#define ACCEL_SHOCK_DEFAULT_MG 500
+#define ACCEL_TILT_DEFAULT_DEG 30
+#define ACCEL_TILT_HYST_DEG 2
+
+#define ENERGY_INTERVAL_MIN_MSEC 10
+#define ENERGY_INTERVAL_MAX_MSEC 1000
+#define ENERGY_INTERVAL_DEFAULT_MSEC 100
+
+#define UPS_INTERVAL_MIN_MSEC 50
+#define UPS_INTERVAL_DEFAULT_MSEC 500
+#define UPS_STATUS_CHARGING 4
+#define UPS_STATUS_CHARGED 5
+#define UPS_STATUS_BACKUP 6
+#define UPS_STATUS_BACKUP_LOW 7
+#define UPS_SD_STATE_IDLE 0
+#define UPS_SD_STATE_PENDING 1
+#define UPS_SD_STATE_TRIGGERED 2
+
+#define AIN_SYNC_RING_SIZE 256
+// one board tick: 10 register reads at 100 kHz, with margin
+#define AIN_SYNC_BOARD_USEC 10000
+#define AIN_SYNC_INTERVAL_DEFAULT_USEC 100000
+#define AIN_ALARM_STATE_OK '0'
+
 struct DeviceAttrRegSpecs {
   uint8_t reg;
   uint8_t len;
@@ -48,14 +166,18 @@ struct DeviceAttrRegSpecs {
   uint8_t base;
 };
 
+struct DeviceBean;
+
 struct DeviceAttrBean {
   struct device_attribute devAttr;
   struct DeviceAttrRegSpecs regSpecs;
-  struct DeviceAttrRegSpecs regSpecsStore;
   uint8_t bitMapLen;
   uint8_t bitMapStart;
   struct GpioBean *gpio;
+  struct GpioBean **gpios;
+  struct GpioArrayBean *gpioArray;
   const char *vals;
+  struct DeviceBean *deviceBean;
 };
 
 struct DeviceBean {
@@ -63,8 +185,63 @@ struct DeviceBean {
   struct DeviceAttrBean *devAttrBeans;
   struct device *device;
   uint8_t *expbTypes;
+  struct attribute_group group;
 };
 
+/*
+ * DeviceAttrBean table rows.
+ * DEV_I2C_RW/DEV_I2C_RO: file backed by a register segment, one row each.
+ * Other rows are built as {DEV_ATTR(...), <specs>, <optional fields>}:
+ * DEV_REG/DEV_REG_BASE: register segment (reg, len, mask, shift, sign[, base])
+ * DEV_PARAM: parameter selector passed in regSpecs.reg to custom show/store
+ * DEV_MAP: bit-mapped files, N = 1 ... len, shift = shift * (N - 1) + start
+ * DEV_INDEX_MAP: len files with index N - 1 in regSpecs.shift
+ */
+#define DEV_ATTR(_name, _mode, _show, _store)                                  \
+  .devAttr = {                                                                 \
+      .attr = {.name = _name, .mode = _mode},                                  \
+      .show = _show,                                                           \
+      .store = _store,                                                         \
+  }
+
+#define DEV_REG(_reg, _len, _mask, _shift, _sign)                              \
+  .regSpecs = {                                                                \
+      .reg = _reg,                                                             \
+      .len = _len,                                                             \
+      .mask = _mask,                                                           \
+      .shift = _shift,                                                         \
+      .sign = _sign,                                                           \
+  }
+
+#define DEV_REG_BASE(_reg, _len, _mask, _shift, _sign, _base)                  \
+  .regSpecs = {                                                                \
+      .reg = _reg,                                                             \
+      .len = _len,                                                             \
+      .mask = _mask,                                                           \
+      .shift = _shift,                                                         \
+      .sign = _sign,                                                           \
+      .base = _base,                                                           \
+  }
+
+#define DEV_PARAM(_param) .regSpecs = {.reg = _param}
+
+#define DEV_MAP(_len, _start) .bitMapLen = _len, .bitMapStart = _start
+
+#define DEV_INDEX_MAP(_param, _len)                                            \
+  .regSpecs = {.reg = _param, .shift = 1}, .bitMapLen = _len, .bitMapStart = 0
+
+#define DEV_I2C_RW(_name, _reg, _len, _mask, _shift, _sign)                    \
+  {                                                                            \
+    DEV_ATTR(_name, 0660, devAttrI2c_show, devAttrI2c_store),                  \
+        DEV_REG(_reg, _len, _mask, _shift, _sign),                             \
+  }
+
+#define DEV_I2C_RO(_name, _reg, _len, _mask, _shift, _sign)                    \
+  {                                                                            \
+    DEV_ATTR(_name, 0440, devAttrI2c_show, NULL),                              \
+        DEV_REG(_reg, _len, _mask, _shift, _sign),                             \
+  }
+
 struct DeviceData {
   int8_t expbIdx;
   struct device *device;
@@ -73,9 +250,304 @@ struct DeviceData {
 
 struct ExpbBean {
   uint8_t type;
+  uint32_t serial;
+  bool serialValid;
   struct DeviceData *data;
 };
 
+enum PidParam {
+  PID_SETPOINT,
+  PID_KP,
+  PID_KI,
+  PID_KD,
+  PID_OUT_MIN,
+  PID_OUT_MAX,
+  PID_ANTI_WINDUP,
+  PID_PERIOD,
+  PID_PARAMS_NUM,
+};
+
+enum PidStat {
+  PID_STAT_CYCLES,
+  PID_STAT_OVERRUNS,
+  PID_STAT_ERRORS,
+  PID_STAT_JITTER_MAX,
+  PID_STAT_JITTER_AVG,
+  PID_STAT_IN,
+  PID_STAT_OUT,
+  PID_STATS_NUM,
+};
+
+struct SamplerBean {
+  unsigned int interval_ms;
+  void (*sample)(struct SamplerBean *s);
+  struct delayed_work work;
+  struct mutex lock;
+  bool running;
+};
+
+enum AinAlarmParam {
+  ALARM_ENABLED,
+  ALARM_HIGH,
+  ALARM_LOW,
+  ALARM_HYST,
+  ALARM_DELAY,
+  ALARM_PARAMS_NUM,
+};
+
+struct AinAlarmBean {
+  int32_t params[ALARM_PARAMS_NUM];
+  char state;
+  char pending;
+  ktime_t pendingSince;
+};
+
+struct AinBoardBean {
+  struct SamplerBean sampler;
+  struct mutex lock;
+  struct device *device;
+  bool syncEnabled;
+  int32_t vals[AIN_CHANNELS_NUM];
+  struct AinAlarmBean alarms[AIN_CHANNELS_NUM];
+};
+
+/*
+ * Synchronized acquisition record, one per enabled board per sampling tick.
+ * All the records of a tick share the same timestamp and sequence number.
+ */
+struct AinSyncRecord {
+  uint64_t timestamp_ns;
+  uint32_t seq;
+  uint32_t span_us;
+  uint8_t slot;
+  uint8_t valid;
+  uint16_t reserved;
+  int32_t vals[AIN_CHANNELS_NUM];
+} __packed;
+
+enum AinSyncStat {
+  AIN_SYNC_STAT_SEQ,
+  AIN_SYNC_STAT_OVERRUNS,
+  AIN_SYNC_STAT_DROPPED,
+  AIN_SYNC_STAT_ERRORS,
+  AIN_SYNC_STATS_NUM,
+};
+
+struct AinSyncBean {
+  struct task_struct *task;
+  struct mutex lock;
+  uint32_t interval_usec;
+  uint64_t stats[AIN_SYNC_STATS_NUM];
+  spinlock_t ringLock;
+  wait_queue_head_t wq;
+  unsigned int head;
+  unsigned int tail;
+  bool open;
+  struct AinSyncRecord ring[AIN_SYNC_RING_SIZE];
+};
+
+enum HwmonVal {
+  HWMON_TEMP,
+  HWMON_TEMP_MAX,
+  HWMON_TEMP_HYST,
+  HWMON_VIN_V,
+  HWMON_VIN_I,
+  HWMON_UPS_V,
+  HWMON_UPS_I,
+  HWMON_VALS_NUM,
+};
+
+struct HwmonBean {
+  struct SamplerBean sampler;
+  struct device *device;
+  int8_t upsExpbIdx;
+  int32_t vals[HWMON_VALS_NUM];
+  unsigned long validMask;
+};
+
+#define GPIOCHIP_EXP_LINES_NUM 8
+#define GPIOCHIP_LINE_SD_ROUTE 8
+#define GPIOCHIP_LINE_LTE_START 9
+#define GPIOCHIP_LINES_NUM 17
+
+struct GpioChipBean {
+  struct gpio_chip chip;
+  struct gpio_desc *exp[GPIOCHIP_EXP_LINES_NUM];
+  char expConIds[GPIOCHIP_EXP_LINES_NUM][24];
+  struct mutex lock;
+  bool registered;
+};
+
+struct LedBean {
+  struct led_classdev cdev;
+  uint8_t reg;
+  struct work_struct work;
+  uint16_t blinkOn;
+  uint16_t blinkOff;
+  bool registered;
+};
+
+enum ButtonKey {
+  BUTTON_KEY_PRESS,
+  BUTTON_KEY_LONG_PRESS,
+  BUTTON_KEYS_NUM,
+};
+
+enum ButtonParam {
+  BUTTON_PARAM_INTERVAL,
+  BUTTON_PARAM_LONG_PRESS,
+};
+
+struct ButtonBean {
+  struct SamplerBean sampler;
+  struct input_dev *input;
+  unsigned short keymap[BUTTON_KEYS_NUM];
+  unsigned int longPress_ms;
+  bool valid;
+  bool pressed;
+  uint8_t count;
+  ktime_t pressedSince;
+  bool longSent;
+};
+
+enum AccelParam {
+  ACCEL_SHOCK_THRESHOLD,
+  ACCEL_TILT_THRESHOLD,
+  ACCEL_PARAMS_NUM,
+  ACCEL_INTERVAL = ACCEL_PARAMS_NUM,
+  ACCEL_CALIBRATE,
+  ACCEL_PEAK,
+  ACCEL_SHOCK_COUNT,
+  ACCEL_TILT,
+  ACCEL_TILT_ANGLE,
+};
+
+struct AccelBean {
+  struct SamplerBean sampler;
+  struct mutex lock;
+  struct device *device;
+  int32_t params[ACCEL_PARAMS_NUM];
+  int32_t base[3];
+  bool calibrate;
+  int32_t peak;
+  bool shock;
+  uint32_t shockCount;
+  bool tilt;
+  int32_t angle;
+};
+
+struct EnergyBean {
+  struct SamplerBean sampler;
+  spinlock_t lock;
+  bool valid;
+  ktime_t last;
+  int32_t vin_mV;
+  int32_t vin_mA;
+  uint64_t power;
+  uint64_t peak_uW;
+  uint64_t energy_uJ;
+  uint32_t rem_pJ;
+};
+
+enum UpsShutdownParam {
+  UPS_SD_ENABLED,
+  UPS_SD_TRIGGER,
+  UPS_SD_GRACE,
+  UPS_SD_PARAMS_NUM,
+};
+
+struct UpsBean {
+  struct SamplerBean sampler;
+  struct power_supply *mainsPsy;
+  struct power_supply *battPsy;
+  struct device *device;
+  int8_t expbIdx;
+  uint8_t type;
+  bool valid;
+  uint8_t status;
+  bool backup;
+  int32_t chargerV;
+  int32_t chargerI;
+  int32_t capacity;
+  int64_t charge;
+  bool chargeValid;
+  int32_t dischargeI;
+  ktime_t ccLast;
+  bool ccLastValid;
+  uint16_t sdParams[UPS_SD_PARAMS_NUM];
+  uint8_t sdState;
+  ktime_t sdSince;
+};
+
+struct FanBean {
+  struct SamplerBean sampler;
+  struct mutex lock;
+  struct thermal_zone_device *tz;
+  struct thermal_cooling_device *cdev;
+  int32_t cpuOffset;
+  int32_t temp;
+  bool tempValid;
+  unsigned long state;
+  int32_t savedOn;
+  int32_t savedOff;
+};
+
+struct WdtBean {
+  struct watchdog_device wdd;
+  struct hrtimer preTimer;
+  ktime_t lastPing;
+  bool registered;
+};
+
+enum KhbParam {
+  KHB_PERIOD,
+  KHB_KEEPALIVE_TIMEOUT,
+  KHB_WQ_TIMEOUT,
+  KHB_PARAMS_NUM,
+};
+
+struct KhbBean {
+  struct task_struct *task;
+  struct mutex lock;
+  struct mutex pathLock;
+  uint32_t params[KHB_PARAMS_NUM];
+  char fsPath[KHB_FS_PATH_LEN];
+  // ktime ns, stored from sysfs and the work item; atomic64 to avoid tearing
+  atomic64_t lastKeepalive;
+  struct work_struct wqWork;
+  ktime_t wqQueued;
+  atomic64_t wqStamp;
+  uint8_t health;
+};
+
+enum PwrNotifyParam {
+  PWR_DOWN_ON_POWEROFF,
+  PWR_DOWN_ON_PANIC,
+  PWR_PANIC_WDT_TIMEOUT,
+  PWR_NOTIFY_PARAMS_NUM,
+};
+
+struct PwrNotifyBean {
+  struct notifier_block rebootNb;
+  struct notifier_block panicNb;
+  bool rebootRegistered;
+  bool panicRegistered;
+  uint16_t params[PWR_NOTIFY_PARAMS_NUM];
+};
+
+struct PidLoopBean {
+  struct task_struct *task;
+  int8_t inExpbIdx;
+  int8_t inChannel;
+  int8_t outChannel;
+  int32_t params[PID_PARAMS_NUM];
+  int64_t integral;
+  int64_t prevErr;
+  bool first;
+  int64_t stats[PID_STATS_NUM];
+  uint64_t jitterSum_usec;
+};
+
 static ssize_t devAttrI2c_store(struct device *dev,
                                 struct device_attribute *attr, const char *buf,
                                 size_t count);
@@ -123,4782 +595,5570 @@ static ssize_t devAttrBlink_store(struct device *dev,
                                   struct device_attribute *attr,
                                   const char *buf, size_t count);
 
+static ssize_t devAttrPidEnabled_show(struct device *dev,
+                                      struct device_attribute *attr,
+                                      char *buf);
+
+static ssize_t devAttrPidEnabled_store(struct device *dev,
+                                       struct device_attribute *attr,
+                                       const char *buf, size_t count);
+
+static ssize_t devAttrPidInput_show(struct device *dev,
+                                    struct device_attribute *attr, char *buf);
+
+static ssize_t devAttrPidInput_store(struct device *dev,
+                                     struct device_attribute *attr,
+                                     const char *buf, size_t count);
+
+static ssize_t devAttrPidOutput_show(struct device *dev,
+                                     struct device_attribute *attr, char *buf);
+
+static ssize_t devAttrPidOutput_store(struct device *dev,
+                                      struct device_attribute *attr,
+                                      const char *buf, size_t count);
+
+static ssize_t devAttrPidParam_show(struct device *dev,
+                                    struct device_attribute *attr, char *buf);
+
+static ssize_t devAttrPidParam_store(struct device *dev,
+                                     struct device_attribute *attr,
+                                     const char *buf, size_t count);
+
+static ssize_t devAttrPidStat_show(struct device *dev,
+                                   struct device_attribute *attr, char *buf);
+
+static ssize_t devAttrAinAlarmInterval_show(struct device *dev,
+                                            struct device_attribute *attr,
+                                            char *buf);
+
+static ssize_t devAttrAinAlarmInterval_store(struct device *dev,
+                                             struct device_attribute *attr,
+                                             const char *buf, size_t count);
+
+static ssize_t devAttrAinAlarmParam_show(struct device *dev,
+                                         struct device_attribute *attr,
+                                         char *buf);
+
+static ssize_t devAttrAinAlarmParam_store(struct device *dev,
+                                          struct device_attribute *attr,
+                                          const char *buf, size_t count);
+
+static ssize_t devAttrAinAlarm_show(struct device *dev,
+                                    struct device_attribute *attr, char *buf);
+
+static ssize_t devAttrAinSyncEnabled_show(struct device *dev,
+                                          struct device_attribute *attr,
+                                          char *buf);
+
+static ssize_t devAttrAinSyncEnabled_store(struct device *dev,
+                                           struct device_attribute *attr,
+                                           const char *buf, size_t count);
+
+static ssize_t devAttrAinSyncInterval_show(struct device *dev,
+                                           struct device_attribute *attr,
+                                           char *buf);
+
+static ssize_t devAttrAinSyncInterval_store(struct device *dev,
+                                            struct device_attribute *attr,
+                                            const char *buf, size_t count);
+
+static ssize_t devAttrAinSyncStat_show(struct device *dev,
+                                       struct device_attribute *attr,
+                                       char *buf);
+
+static ssize_t devAttrUpsMonitorInterval_show(struct device *dev,
+                                              struct device_attribute *attr,
+                                              char *buf);
+
+static ssize_t devAttrUpsMonitorInterval_store(struct device *dev,
+                                               struct device_attribute *attr,
+                                               const char *buf, size_t count);
+
+static ssize_t devAttrFanThermalInterval_show(struct device *dev,
+                                              struct device_attribute *attr,
+                                              char *buf);
+
+static ssize_t devAttrFanThermalInterval_store(struct device *dev,
+                                               struct device_attribute *attr,
+                                               const char *buf, size_t count);
+
+static ssize_t devAttrFanThermalCpuOffset_show(struct device *dev,
+                                               struct device_attribute *attr,
+                                               char *buf);
+
+static ssize_t devAttrFanThermalCpuOffset_store(struct device *dev,
+                                                struct device_attribute *attr,
+                                                const char *buf,
+                                                size_t count);
+
+static ssize_t devAttrKhbEnabled_show(struct device *dev,
+                                      struct device_attribute *attr,
+                                      char *buf);
+
+static ssize_t devAttrKhbEnabled_store(struct device *dev,
+                                       struct device_attribute *attr,
+                                       const char *buf, size_t count);
+
+static ssize_t devAttrKhbParam_show(struct device *dev,
+                                    struct device_attribute *attr,
+                                    char *buf);
+
+static ssize_t devAttrKhbParam_store(struct device *dev,
+                                     struct device_attribute *attr,
+                                     const char *buf, size_t count);
+
+static ssize_t devAttrKhbFsPath_show(struct device *dev,
+                                     struct device_attribute *attr,
+                                     char *buf);
+
+static ssize_t devAttrKhbFsPath_store(struct device *dev,
+                                      struct device_attribute *attr,
+                                      const char *buf, size_t count);
+
+static ssize_t devAttrKhbKeepalive_store(struct device *dev,
+                                         struct device_attribute *attr,
+                                         const char *buf, size_t count);
+
+static ssize_t devAttrKhbHealth_show(struct device *dev,
+                                     struct device_attribute *attr,
+                                     char *buf);
+
+static ssize_t devAttrPwrNotify_show(struct device *dev,
+                                     struct device_attribute *attr,
+                                     char *buf);
+
+static ssize_t devAttrPwrNotify_store(struct device *dev,
+                                      struct device_attribute *attr,
+                                      const char *buf, size_t count);
+
+static ssize_t devAttrUpsShutdown_show(struct device *dev,
+                                       struct device_attribute *attr,
+                                       char *buf);
+
+static ssize_t devAttrUpsShutdown_store(struct device *dev,
+                                        struct device_attribute *attr,
+                                        const char *buf, size_t count);
+
+static ssize_t devAttrUpsSoc_show(struct device *dev,
+                                  struct device_attribute *attr, char *buf);
+
+static ssize_t devAttrUpsTimeToEmpty_show(struct device *dev,
+                                          struct device_attribute *attr,
+                                          char *buf);
+
+static ssize_t devAttrEnergy_show(struct device *dev,
+                                  struct device_attribute *attr, char *buf);
+
+static ssize_t devAttrEnergy_store(struct device *dev,
+                                   struct device_attribute *attr,
+                                   const char *buf, size_t count);
+
+static ssize_t devAttrEnergyPeak_show(struct device *dev,
+                                      struct device_attribute *attr,
+                                      char *buf);
+
+static ssize_t devAttrEnergyPeak_store(struct device *dev,
+                                       struct device_attribute *attr,
+                                       const char *buf, size_t count);
+
+static ssize_t devAttrEnergyInterval_show(struct device *dev,
+                                          struct device_attribute *attr,
+                                          char *buf);
+
+static ssize_t devAttrEnergyInterval_store(struct device *dev,
+                                           struct device_attribute *attr,
+                                           const char *buf, size_t count);
+
+static ssize_t devAttrAccelDetectEnabled_show(struct device *dev,
+                                              struct device_attribute *attr,
+                                              char *buf);
+
+static ssize_t devAttrAccelDetectEnabled_store(struct device *dev,
+                                               struct device_attribute *attr,
+                                               const char *buf, size_t count);
+
+static ssize_t devAttrAccelParam_show(struct device *dev,
+                                      struct device_attribute *attr,
+                                      char *buf);
+
+static ssize_t devAttrAccelParam_store(struct device *dev,
+                                       struct device_attribute *attr,
+                                       const char *buf, size_t count);
+
+static ssize_t devAttrButtonInput_show(struct device *dev,
+                                       struct device_attribute *attr,
+                                       char *buf);
+
+static ssize_t devAttrButtonInput_store(struct device *dev,
+                                        struct device_attribute *attr,
+                                        const char *buf, size_t count);
+
+static ssize_t devAttrExpbSerial_show(struct device *dev,
+                                      struct device_attribute *attr,
+                                      char *buf);
+
+static ssize_t devAttrExpbGpios_show(struct device *dev,
+                                     struct device_attribute *attr,
+                                     char *buf);
+
 static const char VALS_SD_SDX_ROUTING[] = {2, 'A', 'B'};
 static const char VALS_AOUT_MODE[] = {2, 'V', 'I'};
 
+static const char *const AIN_CHANNELS[AIN_CHANNELS_NUM] = {
+    "av1", "av2", "av3", "av4", "ai1", "ai2", "ai3", "ai4", "at1", "at2",
+};
+
 static struct GpioBean gpioSdRoute = {
     .name = "stratopimax_sd_route",
     .flags = GPIOD_IN,
 };
 
+static struct GpioArrayBean gpioArrayExp = {
+    .name = "stratopimax_exp",
+    .flags = GPIOD_ASIS,
+};
+
+static struct CaptureGpioBean _expCaptures[8];
+
+static struct GpioBean *_expCaptureGpios[] = {
+    &_expCaptures[0].gpio, &_expCaptures[1].gpio, &_expCaptures[2].gpio,
+    &_expCaptures[3].gpio, &_expCaptures[4].gpio, &_expCaptures[5].gpio,
+    &_expCaptures[6].gpio, &_expCaptures[7].gpio,
+};
+
 static struct DeviceAttrBean devAttrBeansSystem[] = {
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "fw_version",
-                        .mode = 0440,
-                    },
-                .show = devAttrFwVersion_show,
-                .store = NULL,
-            },
+        DEV_ATTR("fw_version", 0440, devAttrFwVersion_show, NULL),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "config",
-                        .mode = 0220,
-                    },
-                .show = NULL,
-                .store = devAttrConfig_store,
-            },
+        DEV_ATTR("config", 0220, NULL, devAttrConfig_store),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "sys_errs",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show_clear,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_SYSMON_SYS_ERRS,
-                .len = 2,
-                .mask = 0x1fff,
-                .base = 2,
-            },
+        DEV_ATTR("sys_errs", 0440, devAttrI2c_show_clear, NULL),
+        DEV_REG_BASE(I2C_REG_SYSMON_SYS_ERRS, 2, 0x1fff, 0, false, 2),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "ioexp_errs",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show_clear,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_SYSMON_IOEXP_ERRS,
-                .len = 2,
-                .mask = 0x7f,
-                .base = 2,
-            },
+        DEV_ATTR("ioexp_errs", 0440, devAttrI2c_show_clear, NULL),
+        DEV_REG_BASE(I2C_REG_SYSMON_IOEXP_ERRS, 2, 0x7f, 0, false, 2),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "_i2c_read",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2cRead_show,
-                .store = devAttrI2cRead_store,
-            },
+        DEV_ATTR("_i2c_read", 0660, devAttrI2cRead_show, devAttrI2cRead_store),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "_i2c_write",
-                        .mode = 0220,
-                    },
-                .show = NULL,
-                .store = devAttrI2cWrite_store,
-            },
+        DEV_ATTR("_i2c_write", 0220, NULL, devAttrI2cWrite_store),
     },
-
     {},
 };
 
 static struct DeviceAttrBean devAttrBeansSd[] = {
+    DEV_I2C_RW("sd_main_enabled", I2C_REG_SD, 2, 0b1, 0, false),
+    DEV_I2C_RW("sd_main_enabled_config", I2C_REG_SD, 2, 0b1, 1, false),
+    DEV_I2C_RW("sd_sec_enabled", I2C_REG_SD, 2, 0b1, 2, false),
+    DEV_I2C_RW("sd_sec_enabled_config", I2C_REG_SD, 2, 0b1, 3, false),
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "sd_main_enabled",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_SD,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("sd_main_routing", 0660, devAttrGpio_show, devAttrI2c_store),
+        DEV_REG(I2C_REG_SD, 2, 0b1, 4, false),
+        .gpio = &gpioSdRoute,
+        .vals = VALS_SD_SDX_ROUTING,
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "sd_main_enabled_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_SD,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 1,
-                .sign = false,
-            },
+        DEV_ATTR("sd_main_routing_config", 0660, devAttrI2c_show,
+                 devAttrI2c_store),
+        DEV_REG(I2C_REG_SD, 2, 0b1, 5, false),
+        .vals = VALS_SD_SDX_ROUTING,
     },
+    {},
+};
 
+static struct DeviceAttrBean devAttrBeansExpb[] = {
+    DEV_I2C_RW("s1_enabled", I2C_REG_EXPB_EN, 2, 0b1, 0, false),
+    DEV_I2C_RW("s1_enabled_config", I2C_REG_EXPB_EN, 2, 0b1, 1, false),
+    DEV_I2C_RW("s1_type", I2C_REG_EXPB_TYPE_S1, 2, 0xff, 0, false),
+    DEV_I2C_RW("s2_enabled", I2C_REG_EXPB_EN, 2, 0b1, 2, false),
+    DEV_I2C_RW("s2_enabled_config", I2C_REG_EXPB_EN, 2, 0b1, 3, false),
+    DEV_I2C_RW("s2_type", I2C_REG_EXPB_TYPE_S2, 2, 0xff, 0, false),
+    DEV_I2C_RW("s3_enabled", I2C_REG_EXPB_EN, 2, 0b1, 4, false),
+    DEV_I2C_RW("s3_enabled_config", I2C_REG_EXPB_EN, 2, 0b1, 5, false),
+    DEV_I2C_RW("s3_type", I2C_REG_EXPB_TYPE_S3, 2, 0xff, 0, false),
+    DEV_I2C_RW("s4_enabled", I2C_REG_EXPB_EN, 2, 0b1, 6, false),
+    DEV_I2C_RW("s4_enabled_config", I2C_REG_EXPB_EN, 2, 0b1, 7, false),
+    DEV_I2C_RW("s4_type", I2C_REG_EXPB_TYPE_S4, 2, 0xff, 0, false),
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "sd_sec_enabled",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_SD,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 2,
-                .sign = false,
-            },
+        DEV_ATTR("s%d_serial", 0440, devAttrExpbSerial_show, NULL),
+        DEV_INDEX_MAP(0, 4),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "sd_sec_enabled_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_SD,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 3,
-                .sign = false,
-            },
+        DEV_ATTR("gpios", 0440, devAttrExpbGpios_show, NULL),
+        .gpioArray = &gpioArrayExp,
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "sd_main_routing",
-                        .mode = 0660,
-                    },
-                .show = devAttrGpio_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_SD,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 4,
-                .sign = false,
-            },
-        .gpio = &gpioSdRoute,
-        .vals = VALS_SD_SDX_ROUTING,
+        DEV_ATTR("capture%d_enabled", 0660, devAttrGpioCap_show,
+                 devAttrGpioCap_store),
+        DEV_INDEX_MAP(0, 8),
+        .gpios = _expCaptureGpios,
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "sd_main_routing_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_SD,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 5,
-                .sign = false,
-            },
-        .vals = VALS_SD_SDX_ROUTING,
+        DEV_ATTR("capture%d_window", 0660, devAttrGpioCapWindow_show,
+                 devAttrGpioCapWindow_store),
+        DEV_INDEX_MAP(0, 8),
+        .gpios = _expCaptureGpios,
+    },
+    {
+        DEV_ATTR("capture%d_period", 0440, devAttrGpioCapPeriod_show, NULL),
+        DEV_INDEX_MAP(0, 8),
+        .gpios = _expCaptureGpios,
+    },
+    {
+        DEV_ATTR("capture%d_duty", 0440, devAttrGpioCapDuty_show, NULL),
+        DEV_INDEX_MAP(0, 8),
+        .gpios = _expCaptureGpios,
+    },
+    {
+        DEV_ATTR("capture%d_frequency", 0440, devAttrGpioCapFreq_show, NULL),
+        DEV_INDEX_MAP(0, 8),
+        .gpios = _expCaptureGpios,
     },
-
     {},
 };
 
-static struct DeviceAttrBean devAttrBeansExpb[] = {
+static struct DeviceAttrBean devAttrBeansPower[] = {
+    DEV_I2C_RW("down_enabled", I2C_REG_POWER_MAIN, 2, 0b1, 0, false),
+    DEV_I2C_RW("up_backup_config", I2C_REG_POWER_MAIN, 2, 0b1, 1, false),
+    DEV_I2C_RW("sd_switch_config", I2C_REG_POWER_MAIN, 2, 0b1, 2, false),
+    DEV_I2C_RW("pcie_switch_config", I2C_REG_POWER_MAIN, 2, 0b1, 3, false),
+    DEV_I2C_RW("down_delay_config", I2C_REG_POWER_DOWN_DELAY, 2, 0, 0, false),
+    DEV_I2C_RW("off_time_config", I2C_REG_POWER_OFF_TIME, 2, 0, 0, false),
+    DEV_I2C_RW("up_delay_config", I2C_REG_POWER_UP_DELAY, 2, 0, 0, false),
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "s1_enabled",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_EXPB_EN,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("down_on_poweroff", 0660, devAttrPwrNotify_show,
+                 devAttrPwrNotify_store),
+        DEV_PARAM(PWR_DOWN_ON_POWEROFF),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "s1_enabled_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_EXPB_EN,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 1,
-                .sign = false,
-            },
+        DEV_ATTR("down_on_panic", 0660, devAttrPwrNotify_show,
+                 devAttrPwrNotify_store),
+        DEV_PARAM(PWR_DOWN_ON_PANIC),
     },
+    {},
+};
 
+static struct DeviceAttrBean devAttrBeansWatchdog[] = {
+    DEV_I2C_RW("enabled", I2C_REG_WDT_MAIN, 2, 0b1, 0, false),
+    DEV_I2C_RW("enabled_config", I2C_REG_WDT_MAIN, 2, 0b1, 1, false),
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "s1_type",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_EXPB_TYPE_S1,
-                .len = 2,
-                .mask = 0xff,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("heartbeat", 0220, NULL, devAttrI2c_store),
+        DEV_REG(I2C_REG_WDT_MAIN, 2, 0b1, 2, false),
     },
-
+    DEV_I2C_RO("expired", I2C_REG_WDT_MAIN, 2, 0b1, 2, false),
+    DEV_I2C_RW("timeout", I2C_REG_WDT_TIMEOUT, 2, 0, 0, false),
+    DEV_I2C_RW("timeout_config", I2C_REG_WDT_TIMEOUT_CFG, 2, 0, 0, false),
+    DEV_I2C_RW("down_delay_config", I2C_REG_WDT_DOWN_DELAY, 2, 0, 0, false),
+    DEV_I2C_RW("sd_switch_config", I2C_REG_WDT_SD_SWITCH_CNT, 2, 0, 0, false),
+    DEV_I2C_RW("pcie_switch_config", I2C_REG_WDT_PCIE_SWITCH_CNT, 2, 0, 0,
+               false),
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "s2_enabled",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_EXPB_EN,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 2,
-                .sign = false,
-            },
+        DEV_ATTR("kheartbeat_enabled", 0660, devAttrKhbEnabled_show,
+                 devAttrKhbEnabled_store),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "s2_enabled_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_EXPB_EN,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 3,
-                .sign = false,
-            },
+        DEV_ATTR("kheartbeat_period", 0660, devAttrKhbParam_show,
+                 devAttrKhbParam_store),
+        DEV_PARAM(KHB_PERIOD),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "s2_type",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_EXPB_TYPE_S2,
-                .len = 2,
-                .mask = 0xff,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("kheartbeat_keepalive", 0220, NULL, devAttrKhbKeepalive_store),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "s3_enabled",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_EXPB_EN,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 4,
-                .sign = false,
-            },
+        DEV_ATTR("kheartbeat_keepalive_timeout", 0660, devAttrKhbParam_show,
+                 devAttrKhbParam_store),
+        DEV_PARAM(KHB_KEEPALIVE_TIMEOUT),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "s3_enabled_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_EXPB_EN,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 5,
-                .sign = false,
-            },
+        DEV_ATTR("kheartbeat_wq_timeout", 0660, devAttrKhbParam_show,
+                 devAttrKhbParam_store),
+        DEV_PARAM(KHB_WQ_TIMEOUT),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "s3_type",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_EXPB_TYPE_S3,
-                .len = 2,
-                .mask = 0xff,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("kheartbeat_fs_path", 0660, devAttrKhbFsPath_show,
+                 devAttrKhbFsPath_store),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "s4_enabled",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_EXPB_EN,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 6,
-                .sign = false,
-            },
+        DEV_ATTR("kheartbeat_health", 0440, devAttrKhbHealth_show, NULL),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "s4_enabled_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_EXPB_EN,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 7,
-                .sign = false,
-            },
+        DEV_ATTR("panic_timeout", 0660, devAttrPwrNotify_show,
+                 devAttrPwrNotify_store),
+        DEV_PARAM(PWR_PANIC_WDT_TIMEOUT),
     },
+    {},
+};
 
+static struct DeviceAttrBean devAttrBeansUsb[] = {
+    DEV_I2C_RW("usb1_enabled", I2C_REG_USB, 2, 1, 0, false),
+    DEV_I2C_RW("usb1_enabled_config", I2C_REG_USB, 2, 1, 1, false),
+    DEV_I2C_RO("usb1_err", I2C_REG_USB, 2, 1, 2, false),
+    DEV_I2C_RW("usb2_enabled", I2C_REG_USB, 2, 1, 8, false),
+    DEV_I2C_RW("usb2_enabled_config", I2C_REG_USB, 2, 1, 9, false),
+    DEV_I2C_RO("usb2_err", I2C_REG_USB, 2, 1, 10, false),
+    {},
+};
+
+static struct DeviceAttrBean devAttrBeansPowerIn[] = {
+    DEV_I2C_RO("mon_v", I2C_REG_SYSMON_VIN_V, 2, 0, 0, false),
+    DEV_I2C_RO("mon_i", I2C_REG_SYSMON_VIN_I, 2, 0, 0, false),
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "s4_type",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_EXPB_TYPE_S4,
-                .len = 2,
-                .mask = 0xff,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("energy", 0660, devAttrEnergy_show, devAttrEnergy_store),
+    },
+    {
+        DEV_ATTR("power_peak", 0660, devAttrEnergyPeak_show,
+                 devAttrEnergyPeak_store),
+    },
+    {
+        DEV_ATTR("energy_interval", 0660, devAttrEnergyInterval_show,
+                 devAttrEnergyInterval_store),
     },
+    {},
+};
 
+static struct DeviceAttrBean devAttrBeansPcie[] = {
+    DEV_I2C_RW("enabled", I2C_REG_PCIE, 2, 1, 0, false),
+    DEV_I2C_RW("enabled_config", I2C_REG_PCIE, 2, 1, 1, false),
     {},
 };
 
-static struct DeviceAttrBean devAttrBeansPower[] = {
+static struct DeviceAttrBean devAttrBeansUps[] = {
+    DEV_I2C_RW("enabled", I2C_REG_OFST_UPS_MAIN, 2, 0b1, 0, false),
+    DEV_I2C_RW("enabled_config", I2C_REG_OFST_UPS_MAIN, 2, 0b1, 1, false),
+    DEV_I2C_RO("backup", I2C_REG_OFST_UPS_STATE, 2, 0b1, 7, false),
+    DEV_I2C_RO("status", I2C_REG_OFST_UPS_STATE, 2, 0b1111, 0, false),
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "down_enabled",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_POWER_MAIN,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("monitor_interval", 0660, devAttrUpsMonitorInterval_show,
+                 devAttrUpsMonitorInterval_store),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "up_backup_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_POWER_MAIN,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 1,
-                .sign = false,
-            },
+        DEV_ATTR("shutdown_enabled", 0660, devAttrUpsShutdown_show,
+                 devAttrUpsShutdown_store),
+        DEV_PARAM(UPS_SD_ENABLED),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "sd_switch_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_POWER_MAIN,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 2,
-                .sign = false,
-            },
+        DEV_ATTR("shutdown_trigger", 0660, devAttrUpsShutdown_show,
+                 devAttrUpsShutdown_store),
+        DEV_PARAM(UPS_SD_TRIGGER),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "pcie_switch_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_POWER_MAIN,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 3,
-                .sign = false,
-            },
+        DEV_ATTR("shutdown_grace", 0660, devAttrUpsShutdown_show,
+                 devAttrUpsShutdown_store),
+        DEV_PARAM(UPS_SD_GRACE),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "down_delay_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_POWER_DOWN_DELAY,
-                .len = 2,
-                .mask = 0,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("shutdown_state", 0440, devAttrUpsShutdown_show, NULL),
+        DEV_PARAM(UPS_SD_PARAMS_NUM),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "off_time_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_POWER_OFF_TIME,
-                .len = 2,
-                .mask = 0,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("soc", 0440, devAttrUpsSoc_show, NULL),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "up_delay_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_POWER_UP_DELAY,
-                .len = 2,
-                .mask = 0,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("time_to_empty", 0440, devAttrUpsTimeToEmpty_show, NULL),
     },
+    {},
+};
+
+static struct DeviceAttrBean devAttrBeansUpsBattery[] = {
+    {
+        DEV_ATTR("battery_v_config", 0660, devAttrUpsBatteryV_show,
+                 devAttrUpsBatteryV_store),
+        DEV_REG(I2C_REG_OFST_UPS_MAIN, 2, 0b1, 2, false),
+    },
+    DEV_I2C_RW("battery_capacity_config", I2C_REG_OFST_UPS_CAPACITY, 2, 0, 0,
+               false),
+    DEV_I2C_RW("battery_i_max", I2C_REG_OFST_UPS_MAX_CHARGE_I, 2, 0, 0, false),
+    DEV_I2C_RW("battery_i_max_config", I2C_REG_OFST_UPS_MAX_CHARGE_I_CFG, 2, 0,
+               0, false),
+    DEV_I2C_RO("battery", I2C_REG_OFST_UPS_STATE, 2, 0b1, 7, false),
+    DEV_I2C_RO("charger_mon_v", I2C_REG_OFST_UPS_VBAT_V, 2, 0, 0, false),
+    DEV_I2C_RO("charger_mon_i", I2C_REG_OFST_UPS_VBAT_I, 2, 0, 0, false),
+    DEV_I2C_RW("down_delay_config", I2C_REG_OFST_UPS_POWER_DOWN_DELAY, 2, 0, 0,
+               false),
+    {},
+};
 
+static struct DeviceAttrBean devAttrBeansPowerOut[] = {
+    DEV_I2C_RW("vso_enabled", I2C_REG_OFST_UPS_MAIN, 2, 0b1, 8, false),
+    DEV_I2C_RW("vso_enabled_config", I2C_REG_OFST_UPS_MAIN, 2, 0b1, 9, false),
     {},
 };
 
-static struct DeviceAttrBean devAttrBeansWatchdog[] = {
+static struct DeviceAttrBean devAttrBeansButton[] = {
+    DEV_I2C_RO("status", I2C_REG_BUTTON, 2, 1, 0, false),
+    DEV_I2C_RO("count", I2C_REG_BUTTON, 2, 0xff, 8, false),
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "enabled",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_WDT_MAIN,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("input_interval", 0660, devAttrButtonInput_show,
+                 devAttrButtonInput_store),
+        DEV_PARAM(BUTTON_PARAM_INTERVAL),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "enabled_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_WDT_MAIN,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 1,
-                .sign = false,
-            },
+        DEV_ATTR("input_long_press", 0660, devAttrButtonInput_show,
+                 devAttrButtonInput_store),
+        DEV_PARAM(BUTTON_PARAM_LONG_PRESS),
     },
+    {},
+};
 
+static struct DeviceAttrBean devAttrBeansBuzzer[] = {
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "heartbeat",
-                        .mode = 0220,
-                    },
-                .show = NULL,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_WDT_MAIN,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 2,
-                .sign = false,
-            },
+        DEV_ATTR("beep", 0220, NULL, devAttrBlink_store),
+        DEV_REG(I2C_REG_BUZZER_T_ON, 2, 0, 0, false),
     },
+    DEV_I2C_RW("tone", I2C_REG_BUZZER_TONE, 2, 0, 0, false),
+    {},
+};
 
+static struct DeviceAttrBean devAttrBeansLed[] = {
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "expired",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_WDT_MAIN,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 2,
-                .sign = false,
-            },
-    },
+        DEV_ATTR("red", 0220, NULL, devAttrBlink_store),
+        DEV_REG(I2C_REG_LED_RED_T_ON, 2, 0, 0, false),
+    },
+    DEV_I2C_RW("red_sys_pwr_up_config", I2C_REG_LED_RED_CFG, 2, 0b1, 0, false),
+    DEV_I2C_RW("red_sys_pwr_down_config", I2C_REG_LED_RED_CFG, 2, 0b1, 1,
+               false),
+    DEV_I2C_RW("red_sys_pwr_off_config", I2C_REG_LED_RED_CFG, 2, 0b1, 2, false),
+    DEV_I2C_RW("red_sys_wd_en_config", I2C_REG_LED_RED_CFG, 2, 0b1, 3, false),
+    DEV_I2C_RW("red_sys_wd_exp_config", I2C_REG_LED_RED_CFG, 2, 0b1, 4, false),
+    DEV_I2C_RW("red_user_priority_config", I2C_REG_LED_RED_CFG, 2, 0b1, 15,
+               false),
+    {
+        DEV_ATTR("green", 0220, NULL, devAttrBlink_store),
+        DEV_REG(I2C_REG_LED_GREEN_T_ON, 2, 0, 0, false),
+    },
+    DEV_I2C_RW("green_sys_pwr_up_config", I2C_REG_LED_GREEN_CFG, 2, 0b1, 0,
+               false),
+    DEV_I2C_RW("green_sys_pwr_down_config", I2C_REG_LED_GREEN_CFG, 2, 0b1, 1,
+               false),
+    DEV_I2C_RW("green_sys_pwr_off_config", I2C_REG_LED_GREEN_CFG, 2, 0b1, 2,
+               false),
+    DEV_I2C_RW("green_sys_wd_en_config", I2C_REG_LED_GREEN_CFG, 2, 0b1, 3,
+               false),
+    DEV_I2C_RW("green_sys_wd_exp_config", I2C_REG_LED_GREEN_CFG, 2, 0b1, 4,
+               false),
+    DEV_I2C_RW("green_user_priority_config", I2C_REG_LED_GREEN_CFG, 2, 0b1, 15,
+               false),
+    {},
+};
 
+static struct DeviceAttrBean devAttrBeansAtecc[] = {
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "timeout",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_WDT_TIMEOUT,
-                .len = 2,
-                .mask = 0,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("serial_num", 0440, devAttrAteccSerial_show, NULL),
     },
+    {},
+};
 
+static struct DeviceAttrBean devAttrBeansFan[] = {
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "timeout_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_WDT_TIMEOUT_CFG,
-                .len = 2,
-                .mask = 0,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("temp", 0440, devAttrLm75a_show, NULL),
+        DEV_REG(0, 0, 0xe0, 0, false),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "down_delay_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_WDT_DOWN_DELAY,
-                .len = 2,
-                .mask = 0,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("temp_on", 0660, devAttrLm75a_show, devAttrLm75a_store),
+        DEV_REG(3, 0, 0x80, 0, false),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "sd_switch_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_WDT_SD_SWITCH_CNT,
-                .len = 2,
-                .mask = 0,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("temp_off", 0660, devAttrLm75a_show, devAttrLm75a_store),
+        DEV_REG(2, 0, 0x80, 0, false),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "pcie_switch_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_WDT_PCIE_SWITCH_CNT,
-                .len = 2,
-                .mask = 0,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("thermal_interval", 0660, devAttrFanThermalInterval_show,
+                 devAttrFanThermalInterval_store),
+    },
+    {
+        DEV_ATTR("thermal_cpu_offset", 0660, devAttrFanThermalCpuOffset_show,
+                 devAttrFanThermalCpuOffset_store),
     },
-
     {},
 };
 
-static struct DeviceAttrBean devAttrBeansUsb[] = {
+static struct DeviceAttrBean devAttrBeansAccel[] = {
+    DEV_I2C_RO("accel_x", I2C_REG_ACCEL_X, 2, 0, 0, true),
+    DEV_I2C_RO("accel_y", I2C_REG_ACCEL_Y, 2, 0, 0, true),
+    DEV_I2C_RO("accel_z", I2C_REG_ACCEL_Z, 2, 0, 0, true),
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "usb1_enabled",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_USB,
-                .len = 2,
-                .mask = 1,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("detect_enabled", 0660, devAttrAccelDetectEnabled_show,
+                 devAttrAccelDetectEnabled_store),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "usb1_enabled_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_USB,
-                .len = 2,
-                .mask = 1,
-                .shift = 1,
-                .sign = false,
-            },
+        DEV_ATTR("detect_interval", 0660, devAttrAccelParam_show,
+                 devAttrAccelParam_store),
+        DEV_PARAM(ACCEL_INTERVAL),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "usb1_err",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_USB,
-                .len = 2,
-                .mask = 1,
-                .shift = 2,
-                .sign = false,
-            },
+        DEV_ATTR("calibrate", 0220, NULL, devAttrAccelParam_store),
+        DEV_PARAM(ACCEL_CALIBRATE),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "usb2_enabled",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_USB,
-                .len = 2,
-                .mask = 1,
-                .shift = 8,
-                .sign = false,
-            },
+        DEV_ATTR("shock_threshold", 0660, devAttrAccelParam_show,
+                 devAttrAccelParam_store),
+        DEV_PARAM(ACCEL_SHOCK_THRESHOLD),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "usb2_enabled_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_USB,
-                .len = 2,
-                .mask = 1,
-                .shift = 9,
-                .sign = false,
-            },
+        DEV_ATTR("shock_count", 0440, devAttrAccelParam_show, NULL),
+        DEV_PARAM(ACCEL_SHOCK_COUNT),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "usb2_err",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_USB,
-                .len = 2,
-                .mask = 1,
-                .shift = 10,
-                .sign = false,
-            },
+        DEV_ATTR("peak", 0660, devAttrAccelParam_show, devAttrAccelParam_store),
+        DEV_PARAM(ACCEL_PEAK),
     },
-
-    {},
-};
-
-static struct DeviceAttrBean devAttrBeansPowerIn[] = {
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "mon_v",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_SYSMON_VIN_V,
-                .len = 2,
-                .mask = 0,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("tilt_threshold", 0660, devAttrAccelParam_show,
+                 devAttrAccelParam_store),
+        DEV_PARAM(ACCEL_TILT_THRESHOLD),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "mon_i",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_SYSMON_VIN_I,
-                .len = 2,
-                .mask = 0,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("tilt_angle", 0440, devAttrAccelParam_show, NULL),
+        DEV_PARAM(ACCEL_TILT_ANGLE),
+    },
+    {
+        DEV_ATTR("tilt", 0440, devAttrAccelParam_show, NULL),
+        DEV_PARAM(ACCEL_TILT),
     },
-
     {},
 };
 
-static struct DeviceAttrBean devAttrBeansPcie[] = {
+static struct DeviceAttrBean devAttrBeansDIn[] = {
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "enabled",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_PCIE,
-                .len = 2,
-                .mask = 1,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("in%d_wb_config", 0660, devAttrI2c_show, devAttrI2c_store),
+        DEV_REG(0, 2, 0b1, 1, false),
+        DEV_MAP(7, 0),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "enabled_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_PCIE,
-                .len = 2,
-                .mask = 1,
-                .shift = 1,
-                .sign = false,
-            },
+        DEV_ATTR("in%d_filter_config", 0660, devAttrI2c_show, devAttrI2c_store),
+        DEV_REG(1, 4, 0xf, 4, false),
+        DEV_MAP(7, 0),
     },
-
-    {},
-};
-
-static struct DeviceAttrBean devAttrBeansUps[] = {
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "enabled",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_OFST_UPS_MAIN,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("in%d", 0440, devAttrI2c_show, NULL),
+        DEV_REG(4, 2, 0x1, 1, false),
+        DEV_MAP(7, 0),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "enabled_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_OFST_UPS_MAIN,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 1,
-                .sign = false,
-            },
+        DEV_ATTR("inputs", 0440, devAttrI2c_show, NULL),
+        DEV_REG_BASE(4, 2, 0x7f, 0, false, 2),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "backup",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_OFST_UPS_STATE,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 7,
-                .sign = false,
-            },
+        DEV_ATTR("in%d_wb", 0660, devAttrI2c_show, devAttrI2c_store),
+        DEV_REG(4, 2, 0x1, 1, false),
+        DEV_MAP(7, 8),
     },
-
+    DEV_I2C_RO("in1_cnt", 8, 2, 0, 0, false),
+    DEV_I2C_RO("in2_cnt", 9, 2, 0, 0, false),
+    DEV_I2C_RO("in3_cnt", 10, 2, 0, 0, false),
+    DEV_I2C_RO("in4_cnt", 11, 2, 0, 0, false),
+    DEV_I2C_RO("in5_cnt", 12, 2, 0, 0, false),
+    DEV_I2C_RO("in6_cnt", 13, 2, 0, 0, false),
+    DEV_I2C_RO("in7_cnt", 14, 2, 0, 0, false),
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "status",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_OFST_UPS_STATE,
-                .len = 2,
-                .mask = 0b1111,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("inputs_wb", 0660, devAttrI2c_show, devAttrI2c_store),
+        DEV_REG_BASE(4, 2, 0x7f, 8, false, 2),
     },
-
+    DEV_I2C_RW("alarm_t1", 6, 2, 0x1, 0, false),
+    DEV_I2C_RW("alarm_t2", 6, 2, 0x1, 1, false),
+    DEV_I2C_RW("over_temp", 6, 2, 0x1, 2, false),
+    DEV_I2C_RO("fault", 6, 2, 0x1, 3, false),
     {},
 };
 
-static struct DeviceAttrBean devAttrBeansUpsBattery[] = {
+static struct DeviceAttrBean devAttrBeansDOut[] = {
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "battery_v_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrUpsBatteryV_show,
-                .store = devAttrUpsBatteryV_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_OFST_UPS_MAIN,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 2,
-                .sign = false,
-            },
+        DEV_ATTR("out%d_pp_config", 0660, devAttrI2c_show, devAttrI2c_store),
+        DEV_REG(2, 4, 0b1, 1, false),
+        DEV_MAP(7, 0),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "battery_capacity_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_OFST_UPS_CAPACITY,
-                .len = 2,
-                .mask = 0,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("out%d_ol_config", 0660, devAttrI2c_show, devAttrI2c_store),
+        DEV_REG(2, 4, 0b1, 1, false),
+        DEV_MAP(7, 8),
     },
-
+    DEV_I2C_RW("join_l_config", 2, 4, 0b1, 16, false),
+    DEV_I2C_RW("join_h_config", 2, 4, 0b1, 17, false),
+    DEV_I2C_RW("watchdog_config", 2, 4, 0b1, 18, false),
+    DEV_I2C_RW("watchdog_timeout_config", 2, 4, 0b11, 19, false),
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "battery_i_max",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_OFST_UPS_MAX_CHARGE_I,
-                .len = 2,
-                .mask = 0,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("out%d", 0660, devAttrI2c_show, devAttrI2c_store),
+        DEV_REG(5, 2, 0x1, 1, false),
+        DEV_MAP(7, 0),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "battery_i_max_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_OFST_UPS_MAX_CHARGE_I_CFG,
-                .len = 2,
-                .mask = 0,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("outputs", 0660, devAttrI2c_show, devAttrI2c_store),
+        DEV_REG_BASE(5, 2, 0x7f, 0, false, 2),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "battery",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_OFST_UPS_STATE,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 7,
-                .sign = false,
-            },
+        DEV_ATTR("out%d_ol", 0660, devAttrI2c_show, devAttrI2c_store),
+        DEV_REG(5, 2, 0x1, 1, false),
+        DEV_MAP(7, 8),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "charger_mon_v",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_OFST_UPS_VBAT_V,
-                .len = 2,
-                .mask = 0,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("outputs_ol", 0660, devAttrI2c_show, devAttrI2c_store),
+        DEV_REG_BASE(5, 2, 0x7f, 8, false, 2),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "charger_mon_i",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_OFST_UPS_VBAT_I,
-                .len = 2,
-                .mask = 0,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("out%d_ov", 0660, devAttrI2c_show, devAttrI2c_store),
+        DEV_REG(7, 4, 0x1, 1, false),
+        DEV_MAP(7, 0),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "down_delay_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_OFST_UPS_POWER_DOWN_DELAY,
-                .len = 2,
-                .mask = 0,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("outputs_ov", 0660, devAttrI2c_show, devAttrI2c_store),
+        DEV_REG_BASE(7, 4, 0x7f, 0, false, 2),
     },
-
-    {},
-};
-
-static struct DeviceAttrBean devAttrBeansPowerOut[] = {
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "vso_enabled",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_OFST_UPS_MAIN,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 8,
-                .sign = false,
-            },
+        DEV_ATTR("out%d_ot", 0660, devAttrI2c_show, devAttrI2c_store),
+        DEV_REG(7, 4, 0x1, 1, false),
+        DEV_MAP(7, 8),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "vso_enabled_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_OFST_UPS_MAIN,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 9,
-                .sign = false,
-            },
+        DEV_ATTR("outputs_ot", 0660, devAttrI2c_show, devAttrI2c_store),
+        DEV_REG_BASE(7, 4, 0x7f, 8, false, 2),
     },
-
-    {},
-};
-
-static struct DeviceAttrBean devAttrBeansButton[] = {
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "status",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_BUTTON,
-                .len = 2,
-                .mask = 1,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("out%d_ov_lock", 0440, devAttrI2c_show, NULL),
+        DEV_REG(7, 4, 0x1, 1, false),
+        DEV_MAP(7, 16),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "count",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_BUTTON,
-                .len = 2,
-                .mask = 0xff,
-                .shift = 8,
-                .sign = false,
-            },
+        DEV_ATTR("outputs_ov_lock", 0440, devAttrI2c_show, NULL),
+        DEV_REG_BASE(7, 4, 0x7f, 16, false, 2),
     },
-
-    {},
-};
-
-static struct DeviceAttrBean devAttrBeansBuzzer[] = {
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "beep",
-                        .mode = 0220,
-                    },
-                .show = NULL,
-                .store = devAttrBlink_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_BUZZER_T_ON,
-                .len = 2,
-                .mask = 0,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("out%d_ot_lock", 0440, devAttrI2c_show, NULL),
+        DEV_REG(7, 4, 0x1, 1, false),
+        DEV_MAP(7, 24),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "tone",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_BUZZER_TONE,
-                .len = 2,
-                .mask = 0,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("outputs_ot_lock", 0440, devAttrI2c_show, NULL),
+        DEV_REG_BASE(7, 4, 0x7f, 24, false, 2),
     },
+    {},
+};
+
+static struct DeviceAttrBean devAttrBeansRs485[] = {
+    DEV_I2C_RW("echo_config", 0, 2, 0b1, 0, false),
+    {},
+};
 
+static struct DeviceAttrBean devAttrBeansRs422[] = {
+    DEV_I2C_RW("ch1_echo_config", 0, 2, 0b1, 0, false),
+    DEV_I2C_RW("ch1_slew_config", 0, 2, 0b1, 1, false),
+    DEV_I2C_RW("ch1_half_duplex_config", 0, 2, 0b1, 2, false),
+    DEV_I2C_RW("ch1_termination_config", 0, 2, 0b1, 3, false),
+    DEV_I2C_RW("ch2_echo_config", 1, 2, 0b1, 0, false),
+    DEV_I2C_RW("ch2_slew_config", 1, 2, 0b1, 1, false),
+    DEV_I2C_RW("ch2_half_duplex_config", 1, 2, 0b1, 2, false),
+    DEV_I2C_RW("ch2_termination_config", 1, 2, 0b1, 3, false),
+    DEV_I2C_RW("ch3_echo_config", 2, 2, 0b1, 0, false),
+    DEV_I2C_RW("ch3_slew_config", 2, 2, 0b1, 1, false),
+    DEV_I2C_RW("ch3_half_duplex_config", 2, 2, 0b1, 2, false),
+    DEV_I2C_RW("ch3_termination_config", 2, 2, 0b1, 3, false),
+    DEV_I2C_RW("ch4_echo_config", 3, 2, 0b1, 0, false),
+    DEV_I2C_RW("ch4_slew_config", 3, 2, 0b1, 1, false),
+    DEV_I2C_RW("ch4_half_duplex_config", 3, 2, 0b1, 2, false),
+    DEV_I2C_RW("ch4_termination_config", 3, 2, 0b1, 3, false),
     {},
 };
 
-static struct DeviceAttrBean devAttrBeansLed[] = {
+static struct DeviceAttrBean devAttrBeansAIn[] = {
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "red",
-                        .mode = 0220,
-                    },
-                .show = NULL,
-                .store = devAttrBlink_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_LED_RED_T_ON,
-                .len = 2,
-                .mask = 0,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("av%d_enabled_config", 0660, devAttrI2c_show,
+                 devAttrI2c_store),
+        DEV_REG(0, 2, 0x1, 4, false),
+        DEV_MAP(4, 0),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "red_sys_pwr_up_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_LED_RED_CFG,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("av%d_bipolar_config", 0660, devAttrI2c_show,
+                 devAttrI2c_store),
+        DEV_REG(0, 2, 0x1, 4, false),
+        DEV_MAP(4, 1),
     },
-
+    DEV_I2C_RW("av1_differential_config", 0, 2, 0x1, 2, false),
+    DEV_I2C_RW("av3_differential_config", 0, 2, 0x1, 10, false),
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "red_sys_pwr_down_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_LED_RED_CFG,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 1,
-                .sign = false,
-            },
+        DEV_ATTR("ai%d_enabled_config", 0660, devAttrI2c_show,
+                 devAttrI2c_store),
+        DEV_REG(1, 2, 0x1, 4, false),
+        DEV_MAP(4, 0),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "red_sys_pwr_off_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_LED_RED_CFG,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 2,
-                .sign = false,
-            },
+        DEV_ATTR("at%d_enabled_config", 0660, devAttrI2c_show,
+                 devAttrI2c_store),
+        DEV_REG(2, 2, 0x1, 4, false),
+        DEV_MAP(2, 0),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "red_sys_wd_en_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_LED_RED_CFG,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 3,
-                .sign = false,
-            },
+        DEV_ATTR("at%d_pt1000_config", 0660, devAttrI2c_show, devAttrI2c_store),
+        DEV_REG(2, 2, 0x1, 4, false),
+        DEV_MAP(2, 1),
     },
-
+    DEV_I2C_RW("at_interval_config", 2, 2, 0xff, 8, false),
+    DEV_I2C_RW("av_filter_config", 3, 2, 0, 0, false),
+    DEV_I2C_RW("ai_filter_config", 4, 2, 0, 0, false),
+    DEV_I2C_RW("at_filter_config", 5, 2, 0, 0, false),
+    DEV_I2C_RW("mode_config", 6, 2, 0b1, 0, false),
+    DEV_I2C_RW("usb_stream_config", 6, 2, 0b1, 2, false),
+    DEV_I2C_RO("av1", 8, 3, 0, 0, true),
+    DEV_I2C_RO("av2", 9, 3, 0, 0, true),
+    DEV_I2C_RO("av3", 10, 3, 0, 0, true),
+    DEV_I2C_RO("av4", 11, 3, 0, 0, true),
+    DEV_I2C_RO("ai1", 12, 3, 0, 0, true),
+    DEV_I2C_RO("ai2", 13, 3, 0, 0, true),
+    DEV_I2C_RO("ai3", 14, 3, 0, 0, true),
+    DEV_I2C_RO("ai4", 15, 3, 0, 0, true),
+    DEV_I2C_RO("at1", 16, 3, 0, 0, true),
+    DEV_I2C_RO("at2", 17, 3, 0, 0, true),
+    DEV_I2C_RO("v5_fault", 18, 2, 1, 0, false),
+    DEV_I2C_RO("av1_sps", 19, 4, 0xffff, 0, true),
+    DEV_I2C_RO("av2_sps", 19, 4, 0xffff, 16, true),
+    DEV_I2C_RO("av3_sps", 20, 4, 0xffff, 0, true),
+    DEV_I2C_RO("av4_sps", 20, 4, 0xffff, 16, true),
+    DEV_I2C_RO("ai1_sps", 21, 4, 0xffff, 0, true),
+    DEV_I2C_RO("ai2_sps", 21, 4, 0xffff, 16, true),
+    DEV_I2C_RO("ai3_sps", 22, 4, 0xffff, 0, true),
+    DEV_I2C_RO("ai4_sps", 22, 4, 0xffff, 16, true),
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "red_sys_wd_exp_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_LED_RED_CFG,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 4,
-                .sign = false,
-            },
+        DEV_ATTR("alarm_interval", 0660, devAttrAinAlarmInterval_show,
+                 devAttrAinAlarmInterval_store),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "red_user_priority_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_LED_RED_CFG,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 15,
-                .sign = false,
-            },
+        DEV_ATTR("av%d_alarm_enabled", 0660, devAttrAinAlarmParam_show,
+                 devAttrAinAlarmParam_store),
+        DEV_INDEX_MAP(ALARM_ENABLED, 4),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "green",
-                        .mode = 0220,
-                    },
-                .show = NULL,
-                .store = devAttrBlink_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_LED_GREEN_T_ON,
-                .len = 2,
-                .mask = 0,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("av%d_alarm_high", 0660, devAttrAinAlarmParam_show,
+                 devAttrAinAlarmParam_store),
+        DEV_INDEX_MAP(ALARM_HIGH, 4),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "green_sys_pwr_up_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_LED_GREEN_CFG,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("av%d_alarm_low", 0660, devAttrAinAlarmParam_show,
+                 devAttrAinAlarmParam_store),
+        DEV_INDEX_MAP(ALARM_LOW, 4),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "green_sys_pwr_down_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_LED_GREEN_CFG,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 1,
-                .sign = false,
-            },
+        DEV_ATTR("av%d_alarm_hyst", 0660, devAttrAinAlarmParam_show,
+                 devAttrAinAlarmParam_store),
+        DEV_INDEX_MAP(ALARM_HYST, 4),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "green_sys_pwr_off_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_LED_GREEN_CFG,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 2,
-                .sign = false,
-            },
+        DEV_ATTR("av%d_alarm_delay", 0660, devAttrAinAlarmParam_show,
+                 devAttrAinAlarmParam_store),
+        DEV_INDEX_MAP(ALARM_DELAY, 4),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "green_sys_wd_en_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_LED_GREEN_CFG,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 3,
-                .sign = false,
-            },
+        DEV_ATTR("av%d_alarm", 0440, devAttrAinAlarm_show, NULL),
+        DEV_INDEX_MAP(ALARM_PARAMS_NUM, 4),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "green_sys_wd_exp_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_LED_GREEN_CFG,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 4,
-                .sign = false,
-            },
+        DEV_ATTR("ai%d_alarm_enabled", 0660, devAttrAinAlarmParam_show,
+                 devAttrAinAlarmParam_store),
+        DEV_REG(ALARM_ENABLED, 0, 0, 1, false),
+        DEV_MAP(4, 4),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "green_user_priority_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_LED_GREEN_CFG,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 15,
-                .sign = false,
-            },
+        DEV_ATTR("ai%d_alarm_high", 0660, devAttrAinAlarmParam_show,
+                 devAttrAinAlarmParam_store),
+        DEV_REG(ALARM_HIGH, 0, 0, 1, false),
+        DEV_MAP(4, 4),
     },
-
-    {},
-};
-
-static struct DeviceAttrBean devAttrBeansAtecc[] = {
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "serial_num",
-                        .mode = 0440,
-                    },
-                .show = devAttrAteccSerial_show,
-                .store = NULL,
-            },
+        DEV_ATTR("ai%d_alarm_low", 0660, devAttrAinAlarmParam_show,
+                 devAttrAinAlarmParam_store),
+        DEV_REG(ALARM_LOW, 0, 0, 1, false),
+        DEV_MAP(4, 4),
     },
-
-    {},
-};
-
-static struct DeviceAttrBean devAttrBeansFan[] = {
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "temp",
-                        .mode = 0440,
-                    },
-                .show = devAttrLm75a_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = 0,
-                .mask = 0xe0,
-            },
+        DEV_ATTR("ai%d_alarm_hyst", 0660, devAttrAinAlarmParam_show,
+                 devAttrAinAlarmParam_store),
+        DEV_REG(ALARM_HYST, 0, 0, 1, false),
+        DEV_MAP(4, 4),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "temp_on",
-                        .mode = 0660,
-                    },
-                .show = devAttrLm75a_show,
-                .store = devAttrLm75a_store,
-            },
-        .regSpecs =
-            {
-                .reg = 3,
-                .mask = 0x80,
-            },
+        DEV_ATTR("ai%d_alarm_delay", 0660, devAttrAinAlarmParam_show,
+                 devAttrAinAlarmParam_store),
+        DEV_REG(ALARM_DELAY, 0, 0, 1, false),
+        DEV_MAP(4, 4),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "temp_off",
-                        .mode = 0660,
-                    },
-                .show = devAttrLm75a_show,
-                .store = devAttrLm75a_store,
-            },
-        .regSpecs =
-            {
-                .reg = 2,
-                .mask = 0x80,
-            },
+        DEV_ATTR("ai%d_alarm", 0440, devAttrAinAlarm_show, NULL),
+        DEV_REG(ALARM_PARAMS_NUM, 0, 0, 1, false),
+        DEV_MAP(4, 4),
     },
-
-    {},
-};
-
-static struct DeviceAttrBean devAttrBeansAccel[] = {
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "accel_x",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_ACCEL_X,
-                .len = 2,
-                .mask = 0,
-                .shift = 0,
-                .sign = true,
-            },
+        DEV_ATTR("at%d_alarm_enabled", 0660, devAttrAinAlarmParam_show,
+                 devAttrAinAlarmParam_store),
+        DEV_REG(ALARM_ENABLED, 0, 0, 1, false),
+        DEV_MAP(2, 8),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "accel_y",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_ACCEL_Y,
-                .len = 2,
-                .mask = 0,
-                .shift = 0,
-                .sign = true,
-            },
+        DEV_ATTR("at%d_alarm_high", 0660, devAttrAinAlarmParam_show,
+                 devAttrAinAlarmParam_store),
+        DEV_REG(ALARM_HIGH, 0, 0, 1, false),
+        DEV_MAP(2, 8),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "accel_z",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = I2C_REG_ACCEL_Z,
-                .len = 2,
-                .mask = 0,
-                .shift = 0,
-                .sign = true,
-            },
+        DEV_ATTR("at%d_alarm_low", 0660, devAttrAinAlarmParam_show,
+                 devAttrAinAlarmParam_store),
+        DEV_REG(ALARM_LOW, 0, 0, 1, false),
+        DEV_MAP(2, 8),
     },
-
-    {},
-};
-
-static struct DeviceAttrBean devAttrBeansDIn[] = {
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "in%d_wb_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 0,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 1,
-                .sign = false,
-            },
-        .bitMapLen = 7,
+        DEV_ATTR("at%d_alarm_hyst", 0660, devAttrAinAlarmParam_show,
+                 devAttrAinAlarmParam_store),
+        DEV_REG(ALARM_HYST, 0, 0, 1, false),
+        DEV_MAP(2, 8),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "in%d_filter_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 1,
-                .len = 4,
-                .mask = 0xf,
-                .shift = 4,
-                .sign = false,
-            },
-        .bitMapLen = 7,
+        DEV_ATTR("at%d_alarm_delay", 0660, devAttrAinAlarmParam_show,
+                 devAttrAinAlarmParam_store),
+        DEV_REG(ALARM_DELAY, 0, 0, 1, false),
+        DEV_MAP(2, 8),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "in%d",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = 4,
-                .len = 2,
-                .mask = 0x1,
-                .shift = 1,
-                .sign = false,
-            },
-        .bitMapLen = 7,
+        DEV_ATTR("at%d_alarm", 0440, devAttrAinAlarm_show, NULL),
+        DEV_REG(ALARM_PARAMS_NUM, 0, 0, 1, false),
+        DEV_MAP(2, 8),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "inputs",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = 4,
-                .len = 2,
-                .mask = 0x7f,
-                .shift = 0,
-                .sign = false,
-                .base = 2,
-            },
+        DEV_ATTR("sync_enabled", 0660, devAttrAinSyncEnabled_show,
+                 devAttrAinSyncEnabled_store),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "in%d_wb",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 4,
-                .len = 2,
-                .mask = 0x1,
-                .shift = 1,
-                .sign = false,
-            },
-        .bitMapLen = 7,
-        .bitMapStart = 8,
+        DEV_ATTR("sync_interval", 0660, devAttrAinSyncInterval_show,
+                 devAttrAinSyncInterval_store),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "in1_cnt",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = 8,
-                .len = 2,
-                .mask = 0,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("sync_seq", 0440, devAttrAinSyncStat_show, NULL),
+        DEV_PARAM(AIN_SYNC_STAT_SEQ),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "in2_cnt",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = 9,
-                .len = 2,
-                .mask = 0,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("sync_overruns", 0440, devAttrAinSyncStat_show, NULL),
+        DEV_PARAM(AIN_SYNC_STAT_OVERRUNS),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "in3_cnt",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = 10,
-                .len = 2,
-                .mask = 0,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("sync_dropped", 0440, devAttrAinSyncStat_show, NULL),
+        DEV_PARAM(AIN_SYNC_STAT_DROPPED),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "in4_cnt",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = 11,
-                .len = 2,
-                .mask = 0,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("sync_errors", 0440, devAttrAinSyncStat_show, NULL),
+        DEV_PARAM(AIN_SYNC_STAT_ERRORS),
     },
+    {},
+};
 
+static struct DeviceAttrBean devAttrBeansAOut[] = {
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "in5_cnt",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = 12,
-                .len = 2,
-                .mask = 0,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("ao%d_mode_config", 0660, devAttrI2c_show, devAttrI2c_store),
+        DEV_REG(0, 2, 0x1, 1, false),
+        DEV_MAP(4, 0),
+        .vals = VALS_AOUT_MODE,
     },
-
+    DEV_I2C_RW("ao1", 6, 2, 0, 0, false),
+    DEV_I2C_RW("ao2", 7, 2, 0, 0, false),
+    DEV_I2C_RW("ao3", 8, 2, 0, 0, false),
+    DEV_I2C_RW("ao4", 9, 2, 0, 0, false),
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "in6_cnt",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = 13,
-                .len = 2,
-                .mask = 0,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("ao%d_errs", 0440, devAttrI2c_show, NULL),
+        DEV_REG_BASE(10, 2, 0b111, 4, false, 2),
+        DEV_MAP(4, 0),
     },
-
+    DEV_I2C_RO("v5_fault", 10, 2, 1, 15, false),
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "in7_cnt",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = 14,
-                .len = 2,
-                .mask = 0,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("pid_enabled", 0660, devAttrPidEnabled_show,
+                 devAttrPidEnabled_store),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "inputs_wb",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 4,
-                .len = 2,
-                .mask = 0x7f,
-                .shift = 8,
-                .sign = false,
-                .base = 2,
-            },
+        DEV_ATTR("pid_input", 0660, devAttrPidInput_show,
+                 devAttrPidInput_store),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "alarm_t1",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 6,
-                .len = 2,
-                .mask = 0x1,
-                .shift = 0,
-                .sign = false,
-            },
+        DEV_ATTR("pid_output", 0660, devAttrPidOutput_show,
+                 devAttrPidOutput_store),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "alarm_t2",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 6,
-                .len = 2,
-                .mask = 0x1,
-                .shift = 1,
-                .sign = false,
-            },
+        DEV_ATTR("pid_setpoint", 0660, devAttrPidParam_show,
+                 devAttrPidParam_store),
+        DEV_PARAM(PID_SETPOINT),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "over_temp",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 6,
-                .len = 2,
-                .mask = 0x1,
-                .shift = 2,
-                .sign = false,
-            },
+        DEV_ATTR("pid_kp", 0660, devAttrPidParam_show, devAttrPidParam_store),
+        DEV_PARAM(PID_KP),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "fault",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = 6,
-                .len = 2,
-                .mask = 0x1,
-                .shift = 3,
-                .sign = false,
-            },
+        DEV_ATTR("pid_ki", 0660, devAttrPidParam_show, devAttrPidParam_store),
+        DEV_PARAM(PID_KI),
     },
-
-    {},
-};
-
-static struct DeviceAttrBean devAttrBeansDOut[] = {
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "out%d_pp_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 2,
-                .len = 4,
-                .mask = 0b1,
-                .shift = 1,
-                .sign = false,
-            },
-        .bitMapLen = 7,
+        DEV_ATTR("pid_kd", 0660, devAttrPidParam_show, devAttrPidParam_store),
+        DEV_PARAM(PID_KD),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "out%d_ol_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 2,
-                .len = 4,
-                .mask = 0b1,
-                .shift = 1,
-                .sign = false,
-            },
-        .bitMapLen = 7,
-        .bitMapStart = 8,
+        DEV_ATTR("pid_out_min", 0660, devAttrPidParam_show,
+                 devAttrPidParam_store),
+        DEV_PARAM(PID_OUT_MIN),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "join_l_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 2,
-                .len = 4,
-                .mask = 0b1,
-                .shift = 16,
-                .sign = false,
-            },
+        DEV_ATTR("pid_out_max", 0660, devAttrPidParam_show,
+                 devAttrPidParam_store),
+        DEV_PARAM(PID_OUT_MAX),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "join_h_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 2,
-                .len = 4,
-                .mask = 0b1,
-                .shift = 17,
-                .sign = false,
-            },
+        DEV_ATTR("pid_anti_windup", 0660, devAttrPidParam_show,
+                 devAttrPidParam_store),
+        DEV_PARAM(PID_ANTI_WINDUP),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "watchdog_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 2,
-                .len = 4,
-                .mask = 0b1,
-                .shift = 18,
-                .sign = false,
-            },
+        DEV_ATTR("pid_period", 0660, devAttrPidParam_show,
+                 devAttrPidParam_store),
+        DEV_PARAM(PID_PERIOD),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "watchdog_timeout_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 2,
-                .len = 4,
-                .mask = 0b11,
-                .shift = 19,
-                .sign = false,
-            },
+        DEV_ATTR("pid_cycles", 0440, devAttrPidStat_show, NULL),
+        DEV_PARAM(PID_STAT_CYCLES),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "out%d",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 5,
-                .len = 2,
-                .mask = 0x1,
-                .shift = 1,
-                .sign = false,
-            },
-        .bitMapLen = 7,
+        DEV_ATTR("pid_overruns", 0440, devAttrPidStat_show, NULL),
+        DEV_PARAM(PID_STAT_OVERRUNS),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "outputs",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 5,
-                .len = 2,
-                .mask = 0x7f,
-                .shift = 0,
-                .sign = false,
-                .base = 2,
-            },
+        DEV_ATTR("pid_errors", 0440, devAttrPidStat_show, NULL),
+        DEV_PARAM(PID_STAT_ERRORS),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "out%d_ol",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 5,
-                .len = 2,
-                .mask = 0x1,
-                .shift = 1,
-                .sign = false,
-            },
-        .bitMapLen = 7,
-        .bitMapStart = 8,
+        DEV_ATTR("pid_jitter_max", 0440, devAttrPidStat_show, NULL),
+        DEV_PARAM(PID_STAT_JITTER_MAX),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "outputs_ol",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 5,
-                .len = 2,
-                .mask = 0x7f,
-                .shift = 8,
-                .sign = false,
-                .base = 2,
-            },
+        DEV_ATTR("pid_jitter_avg", 0440, devAttrPidStat_show, NULL),
+        DEV_PARAM(PID_STAT_JITTER_AVG),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "out%d_ov",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 7,
-                .len = 4,
-                .mask = 0x1,
-                .shift = 1,
-                .sign = false,
-            },
-        .bitMapLen = 7,
-        .bitMapStart = 0,
+        DEV_ATTR("pid_in", 0440, devAttrPidStat_show, NULL),
+        DEV_PARAM(PID_STAT_IN),
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "outputs_ov",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 7,
-                .len = 4,
-                .mask = 0x7f,
-                .shift = 0,
-                .sign = false,
-                .base = 2,
-            },
+        DEV_ATTR("pid_out", 0440, devAttrPidStat_show, NULL),
+        DEV_PARAM(PID_STAT_OUT),
     },
+    {},
+};
 
-    {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "out%d_ot",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 7,
-                .len = 4,
-                .mask = 0x1,
-                .shift = 1,
-                .sign = false,
-            },
-        .bitMapLen = 7,
-        .bitMapStart = 8,
-    },
+static struct DeviceAttrBean devAttrBeansLte[] = {
+    DEV_I2C_RW("enabled", 0, 2, 0b1, 0, false),
+    DEV_I2C_RW("rf_enabled", 0, 2, 0b1, 1, false),
+    DEV_I2C_RW("gps_enabled", 0, 2, 0b1, 2, false),
+    DEV_I2C_RW("reset", 0, 2, 0b1, 3, false),
+    DEV_I2C_RW("gpio5", 0, 2, 0b1, 4, false),
+    DEV_I2C_RO("gpio6", 0, 2, 0b1, 5, false),
+    {},
+};
+
+static uint8_t devUpsExpbTypes[] = {X2_UPS, X2_UPSCAP, 0};
+
+static uint8_t devUpsBatteryExpbTypes[] = {X2_UPS, 0};
+
+static uint8_t devDInExpbTypes[] = {X2_D7, 0};
+
+static uint8_t devDOutExpbTypes[] = {X2_D7, 0};
+
+static uint8_t devRs485ExpbTypes[] = {X2_232_485, X2_CAN_485, 0};
+
+static uint8_t devRs422ExpbTypes[] = {X2_422, 0};
+
+static uint8_t devAInExpbTypes[] = {X2_AIN, 0};
+
+static uint8_t devAOutExpbTypes[] = {X2_AOUT, 0};
+
+static uint8_t devLteExpbTypes[] = {X2_GSM, 0};
 
+static struct DeviceBean devices[] = {
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "outputs_ot",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 7,
-                .len = 4,
-                .mask = 0x7f,
-                .shift = 8,
-                .sign = false,
-                .base = 2,
-            },
+        .name = "system",
+        .devAttrBeans = devAttrBeansSystem,
     },
 
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "out%d_ov_lock",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = 7,
-                .len = 4,
-                .mask = 0x1,
-                .shift = 1,
-                .sign = false,
-            },
-        .bitMapLen = 7,
-        .bitMapStart = 16,
+        .name = "exp_boards",
+        .devAttrBeans = devAttrBeansExpb,
     },
 
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "outputs_ov_lock",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = 7,
-                .len = 4,
-                .mask = 0x7f,
-                .shift = 16,
-                .sign = false,
-                .base = 2,
-            },
+        .name = "power",
+        .devAttrBeans = devAttrBeansPower,
     },
 
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "out%d_ot_lock",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = 7,
-                .len = 4,
-                .mask = 0x1,
-                .shift = 1,
-                .sign = false,
-            },
-        .bitMapLen = 7,
-        .bitMapStart = 24,
+        .name = "watchdog",
+        .devAttrBeans = devAttrBeansWatchdog,
     },
 
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "outputs_ot_lock",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = 7,
-                .len = 4,
-                .mask = 0x7f,
-                .shift = 24,
-                .sign = false,
-                .base = 2,
-            },
+        .name = "button",
+        .devAttrBeans = devAttrBeansButton,
     },
 
-    {},
-};
-
-static struct DeviceAttrBean devAttrBeansRs485[] = {
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "echo_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 0,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 0,
-                .sign = false,
-            },
+        .name = "buzzer",
+        .devAttrBeans = devAttrBeansBuzzer,
     },
 
-    {},
-};
-
-static struct DeviceAttrBean devAttrBeansRs422[] = {
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "ch1_echo_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 0,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 0,
-                .sign = false,
-            },
+        .name = "led",
+        .devAttrBeans = devAttrBeansLed,
     },
 
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "ch1_slew_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 0,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 1,
-                .sign = false,
-            },
+        .name = "usb",
+        .devAttrBeans = devAttrBeansUsb,
     },
 
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "ch1_half_duplex_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 0,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 2,
-                .sign = false,
-            },
+        .name = "sd",
+        .devAttrBeans = devAttrBeansSd,
     },
 
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "ch1_termination_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 0,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 3,
-                .sign = false,
-            },
+        .name = "pcie",
+        .devAttrBeans = devAttrBeansPcie,
     },
 
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "ch2_echo_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 1,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 0,
-                .sign = false,
-            },
+        .name = "power_in",
+        .devAttrBeans = devAttrBeansPowerIn,
     },
 
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "ch2_slew_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 1,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 1,
-                .sign = false,
-            },
+        .name = "fan",
+        .devAttrBeans = devAttrBeansFan,
     },
 
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "ch2_half_duplex_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 1,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 2,
-                .sign = false,
-            },
+        .name = "accelerometer",
+        .devAttrBeans = devAttrBeansAccel,
     },
 
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "ch2_termination_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 1,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 3,
-                .sign = false,
-            },
+        .name = "sec_elem",
+        .devAttrBeans = devAttrBeansAtecc,
     },
 
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "ch3_echo_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 2,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 0,
-                .sign = false,
-            },
+        .name = "ups",
+        .devAttrBeans = devAttrBeansUps,
+        .expbTypes = devUpsExpbTypes,
     },
 
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "ch3_slew_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 2,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 1,
-                .sign = false,
-            },
+        .name = "ups",
+        .devAttrBeans = devAttrBeansUpsBattery,
+        .expbTypes = devUpsBatteryExpbTypes,
     },
 
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "ch3_half_duplex_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 2,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 2,
-                .sign = false,
-            },
+        .name = "power_out",
+        .devAttrBeans = devAttrBeansPowerOut,
+        .expbTypes = devUpsBatteryExpbTypes,
     },
 
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "ch3_termination_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 2,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 3,
-                .sign = false,
-            },
+        .name = "digital_in_s%d",
+        .devAttrBeans = devAttrBeansDIn,
+        .expbTypes = devDInExpbTypes,
     },
 
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "ch4_echo_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 3,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 0,
-                .sign = false,
-            },
+        .name = "digital_out_s%d",
+        .devAttrBeans = devAttrBeansDOut,
+        .expbTypes = devDOutExpbTypes,
     },
 
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "ch4_slew_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 3,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 1,
-                .sign = false,
-            },
+        .name = "rs485_s%d",
+        .devAttrBeans = devAttrBeansRs485,
+        .expbTypes = devRs485ExpbTypes,
     },
 
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "ch4_half_duplex_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 3,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 2,
-                .sign = false,
-            },
+        .name = "rs422_s%d",
+        .devAttrBeans = devAttrBeansRs422,
+        .expbTypes = devRs422ExpbTypes,
     },
 
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "ch4_termination_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 3,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 3,
-                .sign = false,
-            },
+        .name = "analog_in_s%d",
+        .devAttrBeans = devAttrBeansAIn,
+        .expbTypes = devAInExpbTypes,
     },
 
-    {},
-};
-
-static struct DeviceAttrBean devAttrBeansAIn[] = {
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "av%d_enabled_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 0,
-                .len = 2,
-                .mask = 0x1,
-                .shift = 4,
-                .sign = false,
-            },
-        .bitMapLen = 4,
-        .bitMapStart = 0,
+        .name = "analog_out_s%d",
+        .devAttrBeans = devAttrBeansAOut,
+        .expbTypes = devAOutExpbTypes,
     },
 
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "av%d_bipolar_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 0,
-                .len = 2,
-                .mask = 0x1,
-                .shift = 4,
-                .sign = false,
-            },
-        .bitMapLen = 4,
-        .bitMapStart = 1,
+        .name = "lte_s%d",
+        .devAttrBeans = devAttrBeansLte,
+        .expbTypes = devLteExpbTypes,
     },
 
-    {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "av1_differential_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 0,
-                .len = 2,
-                .mask = 0x1,
-                .shift = 2,
-                .sign = false,
-            },
-    },
+    {},
+};
 
-    {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "av3_differential_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 0,
-                .len = 2,
-                .mask = 0x1,
-                .shift = 10,
-                .sign = false,
-            },
-    },
+static uint8_t _fwVerMajor;
+static uint8_t _fwVerMinor;
+static struct class *_pDeviceClass;
+static struct ExpbBean _expbs[4];
 
-    {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "ai%d_enabled_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 1,
-                .len = 2,
-                .mask = 0x1,
-                .shift = 4,
-                .sign = false,
-            },
-        .bitMapLen = 4,
-        .bitMapStart = 0,
-    },
+static struct mutex _i2c_mtx;
+static struct i2c_client *rp2_i2c_client = NULL;
+static struct i2c_client *lm75a_i2c_client = NULL;
+static bool _rp2_probed = false;
+static struct completion _rp2ProbeDone;
+static ASYNC_DOMAIN_EXCLUSIVE(_initDomain);
 
-    {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "at%d_enabled_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 2,
-                .len = 2,
-                .mask = 0x1,
-                .shift = 4,
-                .sign = false,
-            },
-        .bitMapLen = 2,
-        .bitMapStart = 0,
-    },
+static int64_t _i2cReadVal;
+static uint16_t _i2cReadSize;
 
-    {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "at%d_pt1000_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 2,
-                .len = 2,
-                .mask = 0x1,
-                .shift = 4,
-                .sign = false,
-            },
-        .bitMapLen = 2,
-        .bitMapStart = 1,
-    },
+static struct mutex _pid_mtx;
+static struct PidLoopBean _pidLoops[4];
 
-    {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "at_interval_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 2,
-                .len = 2,
-                .mask = 0xff,
-                .shift = 8,
-                .sign = false,
-            },
-    },
+static struct AinBoardBean _ainBoards[4];
+static struct AinSyncBean _ainSync;
+static bool _ainSyncRegistered = false;
 
-    {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "av_filter_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 3,
-                .len = 2,
-                .mask = 0,
-                .shift = 0,
-                .sign = false,
-            },
-    },
+static struct HwmonBean _hwmon;
 
+static struct LedBean _leds[] = {
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "ai_filter_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
+        .cdev =
             {
-                .reg = 4,
-                .len = 2,
-                .mask = 0,
-                .shift = 0,
-                .sign = false,
+                .name = "stratopimax:red:status",
             },
+        .reg = I2C_REG_LED_RED_T_ON,
     },
-
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "at_filter_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
+        .cdev =
             {
-                .reg = 5,
-                .len = 2,
-                .mask = 0,
-                .shift = 0,
-                .sign = false,
+                .name = "stratopimax:green:status",
             },
+        .reg = I2C_REG_LED_GREEN_T_ON,
     },
+};
 
-    {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "mode_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 6,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 0,
-                .sign = false,
-            },
-    },
+static const char *const _gpioChipNames[GPIOCHIP_LINES_NUM] = {
+    "exp1_xx",      "exp1_yy",      "exp2_xx",      "exp2_yy",
+    "exp3_xx",      "exp3_yy",      "exp4_xx",      "exp4_yy",
+    "sd_route",     "lte_s1_gpio5", "lte_s1_gpio6", "lte_s2_gpio5",
+    "lte_s2_gpio6", "lte_s3_gpio5", "lte_s3_gpio6", "lte_s4_gpio5",
+    "lte_s4_gpio6",
+};
 
-    {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "usb_stream_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 6,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 2,
-                .sign = false,
-            },
-    },
+static struct GpioChipBean _gpioChip;
 
-    {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "av1",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = 8,
-                .len = 3,
-                .mask = 0,
-                .shift = 0,
-                .sign = true,
-            },
-    },
+static struct ButtonBean _button;
 
-    {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "av2",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = 9,
-                .len = 3,
-                .mask = 0,
-                .shift = 0,
-                .sign = true,
-            },
-    },
+static struct AccelBean _accel;
 
-    {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "av3",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = 10,
-                .len = 3,
-                .mask = 0,
-                .shift = 0,
-                .sign = true,
-            },
-    },
+static struct EnergyBean _energy;
 
-    {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "av4",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = 11,
-                .len = 3,
-                .mask = 0,
-                .shift = 0,
-                .sign = true,
-            },
-    },
+static struct UpsBean _ups;
 
-    {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "ai1",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = 12,
-                .len = 3,
-                .mask = 0,
-                .shift = 0,
-                .sign = true,
-            },
-    },
+static struct FanBean _fan;
 
-    {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "ai2",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = 13,
-                .len = 3,
-                .mask = 0,
-                .shift = 0,
-                .sign = true,
-            },
-    },
+static struct WdtBean _wdt;
 
-    {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "ai3",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = 14,
-                .len = 3,
-                .mask = 0,
-                .shift = 0,
-                .sign = true,
-            },
-    },
+static struct KhbBean _khb;
 
-    {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "ai4",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = 15,
-                .len = 3,
-                .mask = 0,
-                .shift = 0,
-                .sign = true,
-            },
-    },
+static struct PwrNotifyBean _pwrNotify;
 
-    {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "at1",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = 16,
-                .len = 3,
-                .mask = 0,
-                .shift = 0,
-                .sign = true,
-            },
-    },
+struct GpioBean *gpioGetBean(struct device *dev, struct device_attribute *attr,
+                             const char **vals) {
+  struct DeviceAttrBean *dab;
+  dab = container_of(attr, struct DeviceAttrBean, devAttr);
+  if (dab == NULL) {
+    return NULL;
+  }
+  *vals = dab->vals;
+  if (dab->gpios != NULL) {
+    // bit-mapped files, one line each
+    return dab->gpios[dab->regSpecs.shift];
+  }
+  return dab->gpio;
+}
 
-    {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "at2",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = 17,
-                .len = 3,
-                .mask = 0,
-                .shift = 0,
-                .sign = true,
-            },
-    },
+struct GpioArrayBean *gpioGetArrayBean(struct device *dev,
+                                       struct device_attribute *attr) {
+  struct DeviceAttrBean *dab;
+  dab = container_of(attr, struct DeviceAttrBean, devAttr);
+  if (dab == NULL) {
+    return NULL;
+  }
+  return dab->gpioArray;
+}
 
-    {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "v5_fault",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = 18,
-                .len = 2,
-                .mask = 1,
-                .shift = 0,
-                .sign = false,
-            },
-    },
+static bool _i2c_lock(void) {
+  uint8_t i;
+  for (i = 0; i < 20; i++) {
+    if (mutex_trylock(&_i2c_mtx)) {
+      return true;
+    }
+    msleep(1);
+  }
+  return false;
+}
 
-    {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "av1_sps",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = 19,
-                .len = 4,
-                .mask = 0xffff,
-                .shift = 0,
-                .sign = true,
-            },
-    },
+static void _i2c_unlock(void) { mutex_unlock(&_i2c_mtx); }
 
-    {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "av2_sps",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = 19,
-                .len = 4,
-                .mask = 0xffff,
-                .shift = 16,
-                .sign = true,
-            },
-    },
+static uint8_t _i2c_crc_process(uint8_t crc, uint8_t dByte) {
+  uint8_t k;
+  crc ^= dByte;
+  for (k = 0; k < 8; k++) crc = crc & 0x80 ? (crc << 1) ^ 0x2f : crc << 1;
+  return crc;
+}
 
-    {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "av3_sps",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = 20,
-                .len = 4,
-                .mask = 0xffff,
-                .shift = 0,
-                .sign = true,
-            },
-    },
+static void _i2c_add_crc(int reg, char *data, uint8_t len) {
+  uint8_t i;
+  uint8_t crc;
 
-    {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "av4_sps",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = 20,
-                .len = 4,
-                .mask = 0xffff,
-                .shift = 16,
-                .sign = true,
-            },
-    },
+  crc = _i2c_crc_process(0xff, reg);
+  for (i = 0; i < len; i++) {
+    crc = _i2c_crc_process(crc, data[i]);
+  }
+  data[len] = crc;
+}
 
-    {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "ai1_sps",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = 21,
-                .len = 4,
-                .mask = 0xffff,
-                .shift = 0,
-                .sign = true,
-            },
-    },
+static int64_t _i2c_read_no_lock(uint8_t reg, uint8_t len) {
+  int64_t res;
+  char buf[5];  // max 4 bytes data + 1 byte crc
+  uint8_t i;
+  uint8_t crc;
+#if DEBUG_I2C
+  uint8_t j;
+#endif
 
-    {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "ai2_sps",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = 21,
-                .len = 4,
-                .mask = 0xffff,
-                .shift = 16,
-                .sign = true,
-            },
-    },
+  if (rp2_i2c_client == NULL) {
+    return -ENODEV;
+  }
+
+  for (i = 0; i < 10; i++) {
+    res = i2c_smbus_read_i2c_block_data(rp2_i2c_client, reg, len + 1, buf);
+    if (res == len + 1) {
+      crc = buf[len];
+      _i2c_add_crc(reg, buf, len);
+      if (crc == buf[len]) {
+        break;
+      } else {
+#if DEBUG_I2C
+        pr_notice(LOG_TAG "i2c read error: reg=%d\n", reg);
+        for (j = 0; j < len; j++) {
+          pr_notice(LOG_TAG "data[%d]=0x%x\n", j, buf[j]);
+        }
+        pr_notice(LOG_TAG "crc=0x%x crc_rcv=0x%x\n", buf[len], crc);
+#endif
+        res = -1;
+      }
+    }
+  }
+
+  if (res != len + 1) {
+#if DEBUG_I2C
+    pr_notice(LOG_TAG "i2c read error: %lld\n", res);
+#endif
+    return -EIO;
+  }
+
+  res = 0;
+  for (i = 0; i < len; i++) {
+    res |= (buf[i] & ((int64_t)0xff)) << (i * 8);
+  }
+
+  return res;
+}
+
+static int64_t _i2c_write_no_lock(uint8_t reg, uint8_t len, uint32_t val,
+                                  uint32_t mask) {
+  char buf[9];  // max 4 bytes data + 4 bytes mask + 1 byte crc
+  uint8_t i;
+
+  if (rp2_i2c_client == NULL) {
+    return -ENODEV;
+  }
+
+  for (i = 0; i < len; i++) {
+    buf[i] = val >> (8 * i);
+  }
+  if (mask != 0) {
+    for (i = 0; i < len; i++) {
+      buf[i + len] = mask >> (8 * i);
+    }
+    len *= 2;
+  }
+  _i2c_add_crc(reg, buf, len);
+  len++;
+
+  for (i = 0; i < 10; i++) {
+    if (!i2c_smbus_write_i2c_block_data(rp2_i2c_client, reg, len, buf)) {
+      return len;
+    }
+  }
+  return -EIO;
+}
+
+static int64_t _i2c_read(uint8_t reg, uint8_t len) {
+  int64_t res;
+
+  if (len == 0) {
+    return -EINVAL;
+  }
+
+  if (!_i2c_lock()) {
+    return -EBUSY;
+  }
+
+  res = _i2c_read_no_lock(reg, len);
+
+  _i2c_unlock();
+
+  return res;
+}
+
+static int64_t _i2c_write(uint8_t reg, uint8_t len, uint32_t val,
+                          uint32_t mask) {
+  int64_t res;
+
+  if (!_i2c_lock()) {
+    return -EBUSY;
+  }
+
+  res = _i2c_write_no_lock(reg, len, val, mask);
+
+  _i2c_unlock();
+
+  return res;
+}
+
+static int64_t _i2c_read_segment(uint8_t reg, uint8_t len, uint32_t mask,
+                                 uint8_t shift) {
+  int64_t res;
+  res = _i2c_read(reg, len);
+  if (res < 0) {
+    return res;
+  }
+  res >>= shift;
+  if (mask != 0) {
+    res &= mask;
+  }
+  return res;
+}
+
+static int64_t _i2c_write_segment(uint8_t reg, uint8_t len, uint32_t mask,
+                                  uint8_t shift, uint32_t val, bool readBack) {
+  int64_t res = 0;
+  uint8_t i, j, b;
+  bool ok;
+
+  if (!_i2c_lock()) {
+    return -EBUSY;
+  }
+
+  val <<= shift;
+
+  if (mask != 0) {
+    mask <<= shift;
+    val &= mask;
+  }
+
+  for (i = 0; i < 5; i++) {
+    res = _i2c_write_no_lock(reg, len, val, mask);
+    if (res >= 0) {
+      if (readBack) {
+        for (j = 0; j < 2; j++) {
+          res = _i2c_read_no_lock(reg, len);
+          if (res >= 0) {
+            if (mask != 0) {
+              res &= mask;
+            }
+            ok = true;
+            for (b = 0; b < len; b++) {
+              if (((val >> (b * 8)) & 0xff) != ((res >> (b * 8)) & 0xff)) {
+                ok = false;
+                break;
+              }
+            }
+            if (ok) {
+              res = len;
+              break;
+            }
+            res = -EPERM;
+          }
+#if DEBUG_I2C
+            pr_notice(LOG_TAG "i2c write error: reg=%d len=%d w=0x%x r=0x%x\n",
+                      reg, len, val, (uint32_t)res);
+#endif
+        }
+        if (res >= 0) {
+          break;
+        }
+      } else {
+        break;
+      }
+    }
+  }
+
+  _i2c_unlock();
+
+  return res;
+}
+
+static int _i2c_read_block(uint8_t reg, uint8_t num, uint8_t len,
+                           int64_t *vals) {
+  int64_t res = 0;
+  uint8_t i;
+
+  if (len == 0) {
+    return -EINVAL;
+  }
+
+  if (!_i2c_lock()) {
+    return -EBUSY;
+  }
+
+  // one register per transfer (each carries its own CRC), all under a single
+  // lock hold so that the values are sampled back to back
+  for (i = 0; i < num; i++) {
+    res = _i2c_read_no_lock(reg + i, len);
+    if (res < 0) {
+      break;
+    }
+    vals[i] = res;
+  }
+
+  _i2c_unlock();
+
+  return res < 0 ? res : 0;
+}
+
+static void _sampler_work(struct work_struct *work) {
+  struct SamplerBean *s;
+  s = container_of(to_delayed_work(work), struct SamplerBean, work);
+  s->sample(s);
+  if (READ_ONCE(s->running)) {
+    schedule_delayed_work(&s->work,
+                          msecs_to_jiffies(READ_ONCE(s->interval_ms)));
+  }
+}
+
+static void _sampler_init(struct SamplerBean *s, unsigned int interval_ms,
+                          void (*sample)(struct SamplerBean *s)) {
+  mutex_init(&s->lock);
+  INIT_DELAYED_WORK(&s->work, _sampler_work);
+  s->interval_ms = interval_ms;
+  s->sample = sample;
+  s->running = false;
+}
+
+static void _sampler_start(struct SamplerBean *s) {
+  mutex_lock(&s->lock);
+  if (!s->running) {
+    WRITE_ONCE(s->running, true);
+    schedule_delayed_work(&s->work, 0);
+  }
+  mutex_unlock(&s->lock);
+}
+
+static void _sampler_stop(struct SamplerBean *s) {
+  mutex_lock(&s->lock);
+  if (s->running) {
+    WRITE_ONCE(s->running, false);
+    cancel_delayed_work_sync(&s->work);
+  }
+  mutex_unlock(&s->lock);
+}
+
+static void _sampler_set_interval(struct SamplerBean *s,
+                                  unsigned int interval_ms) {
+  mutex_lock(&s->lock);
+  WRITE_ONCE(s->interval_ms, interval_ms);
+  mutex_unlock(&s->lock);
+}
+
+static void _event_notify(struct device *dev, const char *attrName,
+                          const char *value) {
+  char evtBuf[48];
+  char valBuf[48];
+  char *envp[] = {evtBuf, valBuf, NULL};
+
+  sysfs_notify(&dev->kobj, NULL, attrName);
+
+  snprintf(evtBuf, sizeof(evtBuf), "STRATOPIMAX_EVENT=%s", attrName);
+  snprintf(valBuf, sizeof(valBuf), "STRATOPIMAX_VALUE=%s", value);
+  kobject_uevent_env(&dev->kobj, KOBJ_CHANGE, envp);
+}
+
+static ssize_t devAttrI2c_show(struct device *dev,
+                               struct device_attribute *attr, char *buf) {
+  struct DeviceAttrRegSpecs *specs;
+  struct DeviceAttrBean *dab;
+  struct DeviceData *data;
+  uint8_t reg;
+  int64_t res;
+
+  data = dev_get_drvdata(dev);
+  dab = container_of(attr, struct DeviceAttrBean, devAttr);
+  if (dab == NULL) {
+    return -EFAULT;
+  }
+  specs = &dab->regSpecs;
+  if (specs->len == 0) {
+    return -EFAULT;
+  }
+
+  reg = specs->reg;
+  if (data != NULL) {
+    reg += I2C_EXPB_IDX_TO_REG_START(data->expbIdx);
+  }
+
+  res = _i2c_read_segment(reg, specs->len, specs->mask, specs->shift);
+
+  if (res < 0) {
+    return res;
+  }
+
+  return valToStr(buf, res, dab->vals, specs->sign, specs->len, specs->base,
+                  specs->mask);
+}
+
+static ssize_t devAttrI2c_show_clear(struct device *dev,
+                                     struct device_attribute *attr, char *buf) {
+  ssize_t res = devAttrI2c_show(dev, attr, buf);
+  if (res >= 0) {
+    devAttrI2c_store(dev, attr, "0", 1);
+  }
+  return res;
+}
+
+static ssize_t devAttrI2c_store(struct device *dev,
+                                struct device_attribute *attr, const char *buf,
+                                size_t count) {
+  struct DeviceAttrRegSpecs *specs;
+  struct DeviceAttrBean *dab;
+  struct DeviceData *data;
+  uint8_t reg;
+  int64_t res;
+
+  data = dev_get_drvdata(dev);
+  dab = container_of(attr, struct DeviceAttrBean, devAttr);
+  if (dab == NULL) {
+    return -EFAULT;
+  }
+  specs = &dab->regSpecs;
+  if (specs->len == 0) {
+    return -EFAULT;
+  }
+
+  res = strToVal(buf, dab->vals, specs->sign, specs->base);
+  if (res < 0) {
+    return res;
+  }
+
+  reg = specs->reg;
+  if (data != NULL) {
+    reg += I2C_EXPB_IDX_TO_REG_START(data->expbIdx);
+  }
+
+  res = _i2c_write_segment(reg, specs->len, specs->mask, specs->shift,
+                           (uint32_t)res,
+                           attr->store != NULL && attr->show != NULL);
+
+  if (res < 0) {
+    return res;
+  }
+
+  return count;
+}
+
+static ssize_t devAttrExpbSerial_show(struct device *dev,
+                                      struct device_attribute *attr,
+                                      char *buf) {
+  struct DeviceAttrBean *dab;
+  struct ExpbBean *e;
+
+  dab = container_of(attr, struct DeviceAttrBean, devAttr);
+  if (dab == NULL || dab->regSpecs.shift >= 4) {
+    return -EFAULT;
+  }
+  e = &_expbs[dab->regSpecs.shift];
+  if (!e->serialValid) {
+    return -ENODATA;
+  }
+  return sprintf(buf, "%u\n", e->serial);
+}
+
+// reads a slot line through the gpiochip or the capture holding it, or
+// takes it just for the read if free
+static int _expb_gpio_get_val(int i) {
+  struct CaptureGpioBean *c = &_expCaptures[i];
+  struct gpio_desc *desc;
+  int res;
+
+  mutex_lock(&_gpioChip.lock);
+  mutex_lock(&c->cfgLock);
+  desc = _gpioChip.exp[i];
+  if (desc == NULL && c->descOwned) {
+    desc = c->gpio.desc;
+  }
+  if (desc != NULL) {
+    res = gpiod_get_value_cansleep(desc);
+  } else {
+    c->gpio.flags = GPIOD_ASIS;
+    if (gpioInit(&c->gpio)) {
+      res = PTR_ERR(c->gpio.desc);
+      c->gpio.desc = NULL;
+    } else {
+      res = gpiod_get_value_cansleep(c->gpio.desc);
+      gpioFree(&c->gpio);
+    }
+  }
+  mutex_unlock(&c->cfgLock);
+  mutex_unlock(&_gpioChip.lock);
+  return res;
+}
+
+static ssize_t devAttrExpbGpios_show(struct device *dev,
+                                     struct device_attribute *attr,
+                                     char *buf) {
+  struct GpioArrayBean *a;
+  struct GpioArrayBean lines;
+  unsigned long bits = 0;
+  int res, i;
+
+  a = gpioGetArrayBean(dev, attr);
+  if (a == NULL) {
+    return -EFAULT;
+  }
+  // taken only for the read, so the lines stay free for other users
+  lines = *a;
+  if (gpioArrayInit(&lines) == 0) {
+    res = gpioArrayGetVal(&lines, &bits);
+    gpioArrayFree(&lines);
+    if (res < 0) {
+      return res;
+    }
+    return sprintf(buf, "%lu\n", bits);
+  }
+  res = IS_ERR(lines.descs) ? PTR_ERR(lines.descs) : -EINVAL;
+  if (res != -EBUSY) {
+    return res;
+  }
+  // some line is held: read each one through its holder
+  for (i = 0; i < GPIOCHIP_EXP_LINES_NUM; i++) {
+    res = _expb_gpio_get_val(i);
+    if (res < 0) {
+      return res;
+    }
+    if (res) {
+      bits |= 1ul << i;
+    }
+  }
+  return sprintf(buf, "%lu\n", bits);
+}
+
+static ssize_t getFwVersion(void) {
+  int64_t val;
+  val = _i2c_read(1, 2);
+
+  if (val < 0) {
+    return val;
+  }
+
+  _fwVerMajor = (val >> 8) & 0xff;
+  _fwVerMinor = val & 0xff;
+
+  return 0;
+}
+
+static ssize_t devAttrFwVersion_show(struct device *dev,
+                                     struct device_attribute *attr, char *buf) {
+  int32_t res;
+
+  res = getFwVersion();
+  if (res < 0) {
+    return res;
+  }
+
+  return sprintf(buf, "%d.%d\n", _fwVerMajor, _fwVerMinor);
+}
+
+static ssize_t devAttrConfig_store(struct device *dev,
+                                   struct device_attribute *attr,
+                                   const char *buf, size_t count) {
+  int64_t res;
+  uint32_t val;
+  uint16_t i;
+  char cmd;
+  cmd = toUpper(buf[0]);
+  if (cmd == 'R') {
+    val = 0x02;
+  } else {
+    val = cmd;
+  }
+
+  if (!_i2c_lock()) {
+    return -EBUSY;
+  }
+
+  res = _i2c_write_no_lock(I2C_REG_USER_CFG_CMD, 2, 0x2a00 | val, 0);
+  if (res > 0) {
+    for (i = 0; i < 10; i++) {
+      msleep(1);
+      res = _i2c_read_no_lock(I2C_REG_USER_CFG_STATE, 2);
+      if (res > 0) {
+        if ((res & 0xff) != val) {
+          res = -EBUSY;
+          break;
+        }
+        if (((res >> 10) & 1) == 0) {
+          if (((res >> 8) & 1) == 1) {
+            res = count;
+          } else if (((res >> 11) & 1) == 1) {
+            res = -EINVAL;
+          } else {
+            res = -EFAULT;
+          }
+          break;
+        } else {
+          res = -EBUSY;
+        }
+      }
+    }
+  }
+
+  _i2c_unlock();
+
+  return res;
+}
+
+static ssize_t devAttrI2cRead_show(struct device *dev,
+                                   struct device_attribute *attr, char *buf) {
+  if (_i2cReadSize == 1) {
+    return sprintf(buf, "0x%02x\n", (uint32_t)_i2cReadVal);
+  } else if (_i2cReadSize == 2) {
+    return sprintf(buf, "0x%04x\n", (uint32_t)_i2cReadVal);
+  } else if (_i2cReadSize == 3) {
+    return sprintf(buf, "0x%06x\n", (uint32_t)_i2cReadVal);
+  } else {
+    return sprintf(buf, "0x%08x\n", (uint32_t)_i2cReadVal);
+  }
+}
+
+static ssize_t devAttrI2cRead_store(struct device *dev,
+                                    struct device_attribute *attr,
+                                    const char *buf, size_t count) {
+  unsigned long reg;
+  char *end = NULL;
+
+  reg = simple_strtoul(buf, &end, 10);
+  if (++end < buf + count) {
+    _i2cReadSize = simple_strtoul(end, NULL, 10);
+  } else {
+    _i2cReadSize = 2;
+  }
+
+  if (reg > 255 || _i2cReadSize > 4) {
+    return -EINVAL;
+  }
+
+  _i2cReadVal = _i2c_read(reg, _i2cReadSize);
+
+  if (_i2cReadVal < 0) {
+    return _i2cReadVal;
+  }
+
+  return count;
+}
+
+static ssize_t devAttrI2cWrite_store(struct device *dev,
+                                     struct device_attribute *attr,
+                                     const char *buf, size_t count) {
+  unsigned long reg;
+  unsigned long val = 0;
+  size_t size;
+  char *start = NULL;
+  char *end = NULL;
+
+  reg = simple_strtoul(buf, &end, 10);
+
+  if (++end >= buf + count) {
+    return -EINVAL;
+  }
+
+  start = end;
+  val = simple_strtoul(start, &end, 16);
+
+  size = (end - start) - 2;
+
+  if (reg > 255 || size > 8 || (size % 2) != 0) {
+    return -EINVAL;
+  }
+
+  if (_i2c_write(reg, size / 2, val, 0) < 0) {
+    return -EIO;
+  }
+
+  return count;
+}
+
+static ssize_t devAttrUpsBatteryV_show(struct device *dev,
+                                       struct device_attribute *attr,
+                                       char *buf) {
+  int32_t res;
+  res = devAttrI2c_show(dev, attr, buf);
+  if (res < 0) {
+    return res;
+  }
+  if (buf[0] == '1') {
+    return sprintf(buf, "24000\n");
+  } else {
+    return sprintf(buf, "12000\n");
+  }
+}
+
+static ssize_t devAttrUpsBatteryV_store(struct device *dev,
+                                        struct device_attribute *attr,
+                                        const char *buf, size_t count) {
+  int ret;
+  long val;
+  char buf2[2];
+  ret = kstrtol(buf, 10, &val);
+  if (ret < 0) {
+    return -EINVAL;
+  }
+  if (val == 12000) {
+    buf2[0] = '0';
+  } else if (val == 24000) {
+    buf2[0] = '1';
+  } else {
+    return -EINVAL;
+  }
+
+  buf2[1] = '\0';
+  ret = devAttrI2c_store(dev, attr, buf2, 1);
+  if (ret < 0) {
+    return ret;
+  }
+  return count;
+}
+
+static int32_t _lm75a_read(uint8_t reg, uint8_t mask, int32_t *temp) {
+  int32_t res;
+
+  if (lm75a_i2c_client == NULL) {
+    return -ENODEV;
+  }
+
+  if (!_i2c_lock()) {
+    return -EBUSY;
+  }
+
+  res = i2c_smbus_read_word_data(lm75a_i2c_client, reg);
+
+  _i2c_unlock();
+
+  if (res < 0) {
+    return res;
+  }
+
+  res = ((res & 0xff) << 8) + ((res >> 8) & mask);
+  *temp = ((int16_t)res) * 100 / 256;
+
+  return 0;
+}
+
+static int32_t _lm75a_write(uint8_t reg, uint8_t mask, long temp) {
+  int32_t res;
+
+  if (lm75a_i2c_client == NULL) {
+    return -ENODEV;
+  }
+
+  if (temp > LM75A_TEMP_MAX || temp < LM75A_TEMP_MIN) {
+    return -EINVAL;
+  }
+
+  temp = temp * 256 / 100;
+  temp = ((temp & mask) << 8) + ((temp >> 8) & 0xff);
+
+  if (!_i2c_lock()) {
+    return -EBUSY;
+  }
+
+  res = i2c_smbus_write_word_data(lm75a_i2c_client, reg, temp);
+
+  _i2c_unlock();
+
+  return res;
+}
+
+static int32_t _fan_threshold_read(uint8_t reg, int32_t *temp) {
+  int32_t res = 0;
+
+  mutex_lock(&_fan.lock);
+  if (_fan.state) {
+    *temp = reg == LM75A_REG_TOS ? _fan.savedOn : _fan.savedOff;
+  } else {
+    res = _lm75a_read(reg, LM75A_MASK_THRESHOLD, temp);
+  }
+  mutex_unlock(&_fan.lock);
+
+  return res;
+}
+
+static int32_t _fan_threshold_write(uint8_t reg, long temp) {
+  int32_t res = 0;
+
+  if (temp > LM75A_TEMP_MAX || temp < LM75A_TEMP_MIN) {
+    return -EINVAL;
+  }
+
+  mutex_lock(&_fan.lock);
+  if (_fan.state) {
+    // fan forced on by the cooling device, applied when released
+    temp -= temp % 50;
+    if (reg == LM75A_REG_TOS) {
+      _fan.savedOn = temp;
+    } else {
+      _fan.savedOff = temp;
+    }
+  } else {
+    res = _lm75a_write(reg, LM75A_MASK_THRESHOLD, temp);
+  }
+  mutex_unlock(&_fan.lock);
+
+  return res;
+}
+
+static ssize_t devAttrLm75a_show(struct device *dev,
+                                 struct device_attribute *attr, char *buf) {
+  int32_t res;
+  int32_t temp;
+  struct DeviceAttrBean *dab;
+  dab = container_of(attr, struct DeviceAttrBean, devAttr);
+  if (dab == NULL) {
+    return -EFAULT;
+  }
+
+  if (dab->regSpecs.reg == LM75A_REG_TEMP) {
+    res = _lm75a_read(dab->regSpecs.reg, dab->regSpecs.mask, &temp);
+  } else {
+    res = _fan_threshold_read(dab->regSpecs.reg, &temp);
+  }
+  if (res < 0) {
+    return res;
+  }
+
+  return sprintf(buf, "%d\n", temp);
+}
+
+static ssize_t devAttrLm75a_store(struct device *dev,
+                                  struct device_attribute *attr,
+                                  const char *buf, size_t count) {
+  int32_t res;
+  long temp;
+  struct DeviceAttrBean *dab;
+  dab = container_of(attr, struct DeviceAttrBean, devAttr);
+  if (dab == NULL) {
+    return -EFAULT;
+  }
+
+  res = kstrtol(buf, 10, &temp);
+  if (res < 0) {
+    return res;
+  }
+
+  res = _fan_threshold_write(dab->regSpecs.reg, temp);
+  if (res < 0) {
+    return res;
+  }
+
+  return count;
+}
+
+static ssize_t devAttrBlink_store(struct device *dev,
+                                  struct device_attribute *attr,
+                                  const char *buf, size_t count) {
+  struct DeviceAttrBean *dab;
+  int64_t res;
+  uint16_t on = 0;
+  uint16_t off = 0;
+  uint16_t rep = 0;
+  char *end = NULL;
+
+  dab = container_of(attr, struct DeviceAttrBean, devAttr);
+
+  on = simple_strtoul(buf, &end, 10);
+  if (++end < buf + count) {
+    off = simple_strtoul(end, &end, 10);
+    if (++end < buf + count) {
+      rep = simple_strtoul(end, NULL, 10);
+    }
+  }
+
+  res = _i2c_write_segment(dab->regSpecs.reg, dab->regSpecs.len,
+                           dab->regSpecs.mask, dab->regSpecs.shift, on, true);
+  if (res > 0) {
+    res =
+        _i2c_write_segment(dab->regSpecs.reg + 1, dab->regSpecs.len,
+                           dab->regSpecs.mask, dab->regSpecs.shift, off, true);
+    if (res > 0) {
+      res = _i2c_write_segment(dab->regSpecs.reg + 2, dab->regSpecs.len,
+                               dab->regSpecs.mask, dab->regSpecs.shift, rep,
+                               true);
+    }
+  }
+
+  if (res < 0) {
+    return res;
+  }
+
+  return count;
+}
+
+static struct PidLoopBean *_pid_get(struct device *dev) {
+  struct DeviceData *data;
+  data = dev_get_drvdata(dev);
+  if (data == NULL || data->expbIdx < 0) {
+    return NULL;
+  }
+  return &_pidLoops[data->expbIdx];
+}
+
+static void _pid_step(struct PidLoopBean *p, int64_t dt_usec) {
+  int32_t *prm = p->params;
+  int8_t outExpbIdx = p - _pidLoops;
+  int64_t res, err, integral, dTerm, out;
+
+  res = _i2c_read(I2C_EXPB_IDX_TO_REG_START(p->inExpbIdx) + AIN_REG_VAL_START +
+                      p->inChannel,
+                  3);
+  if (res < 0) {
+    p->stats[PID_STAT_ERRORS]++;
+    return;
+  }
+  res = sign_extend32(res, 23);
+  p->stats[PID_STAT_IN] = res;
+  if (res >= AIN_VAL_OVERRANGE || res <= AIN_VAL_UNDERRANGE) {
+    // hold the last output until the input is valid again
+    p->stats[PID_STAT_ERRORS]++;
+    return;
+  }
+
+  err = prm[PID_SETPOINT] - res;
+  if (dt_usec <= 0) {
+    dt_usec = prm[PID_PERIOD];
+  }
+
+  integral = p->integral + div_s64(div_s64(prm[PID_KI] * err, 1000) * dt_usec,
+                                   1000);
+  if (p->first) {
+    dTerm = 0;
+    p->first = false;
+  } else {
+    dTerm = div_s64(prm[PID_KD] * (err - p->prevErr) * 1000, dt_usec) * 1000;
+  }
+  p->prevErr = err;
+
+  out = div_s64(prm[PID_KP] * err + integral + dTerm, 1000);
+
+  if (prm[PID_ANTI_WINDUP]) {
+    // conditional integration: freeze the integrator while the output is
+    // saturated and the error would push it further into saturation
+    if ((out > prm[PID_OUT_MAX] && err > 0) ||
+        (out < prm[PID_OUT_MIN] && err < 0)) {
+      integral = p->integral;
+    }
+    integral = clamp_t(int64_t, integral, (int64_t)prm[PID_OUT_MIN] * 1000,
+                       (int64_t)prm[PID_OUT_MAX] * 1000);
+  }
+  p->integral = integral;
+
+  out = clamp_t(int64_t, out, prm[PID_OUT_MIN], prm[PID_OUT_MAX]);
+
+  // write-only: no read-back, a failed update is retried on the next tick
+  res = _i2c_write(I2C_EXPB_IDX_TO_REG_START(outExpbIdx) + AOUT_REG_VAL_START +
+                       p->outChannel,
+                   2, (uint32_t)out, 0);
+  if (res < 0) {
+    p->stats[PID_STAT_ERRORS]++;
+    return;
+  }
+  p->stats[PID_STAT_OUT] = out;
+}
+
+static int _pid_thread(void *arg) {
+  struct PidLoopBean *p = arg;
+  ktime_t next, last, now;
+  int64_t jitter_usec;
+
+  next = ktime_get();
+  last = next;
+  while (!kthread_should_stop()) {
+    next = ktime_add_us(next, p->params[PID_PERIOD]);
+    set_current_state(TASK_INTERRUPTIBLE);
+    if (kthread_should_stop()) {
+      __set_current_state(TASK_RUNNING);
+      break;
+    }
+    schedule_hrtimeout(&next, HRTIMER_MODE_ABS);
+
+    now = ktime_get();
+    jitter_usec = ktime_us_delta(now, next);
+    if (jitter_usec < 0) {
+      jitter_usec = 0;
+    }
+    p->stats[PID_STAT_CYCLES]++;
+    p->jitterSum_usec += jitter_usec;
+    if (jitter_usec > p->stats[PID_STAT_JITTER_MAX]) {
+      p->stats[PID_STAT_JITTER_MAX] = jitter_usec;
+    }
+
+    _pid_step(p, ktime_us_delta(now, last));
+    last = now;
+
+    now = ktime_get();
+    if (ktime_after(now, ktime_add_us(next, p->params[PID_PERIOD]))) {
+      // missed at least one deadline: realign instead of bursting
+      p->stats[PID_STAT_OVERRUNS]++;
+      next = now;
+    }
+  }
+  return 0;
+}
+
+static void _pid_stop(struct PidLoopBean *p) {
+  if (p->task != NULL) {
+    kthread_stop(p->task);
+    p->task = NULL;
+  }
+}
+
+static int _pid_start(struct PidLoopBean *p) {
+  struct task_struct *task;
+
+  if (p->inExpbIdx < 0 || p->inChannel < 0 || p->outChannel < 0) {
+    return -EINVAL;
+  }
+  if (p->params[PID_OUT_MIN] > p->params[PID_OUT_MAX]) {
+    return -EINVAL;
+  }
+
+  p->integral = 0;
+  p->prevErr = 0;
+  p->first = true;
+  p->jitterSum_usec = 0;
+  memset(p->stats, 0, sizeof(p->stats));
+
+  task = kthread_run(_pid_thread, p, "stratopimax_pid%d",
+                     (int)(p - _pidLoops) + 1);
+  if (IS_ERR(task)) {
+    return PTR_ERR(task);
+  }
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 9, 0)
+  sched_set_fifo(task);
+#endif
+  p->task = task;
+  return 0;
+}
+
+static void _pid_init(void) {
+  int i;
+  struct PidLoopBean *p;
+
+  for (i = 0; i < 4; i++) {
+    p = &_pidLoops[i];
+    memset(p, 0, sizeof(*p));
+    p->inExpbIdx = -1;
+    p->inChannel = -1;
+    p->outChannel = -1;
+    p->params[PID_OUT_MAX] = AOUT_VAL_MAX_V;
+    p->params[PID_ANTI_WINDUP] = 1;
+    p->params[PID_PERIOD] = PID_PERIOD_DEFAULT_USEC;
+  }
+}
+
+static ssize_t devAttrPidEnabled_show(struct device *dev,
+                                      struct device_attribute *attr,
+                                      char *buf) {
+  struct PidLoopBean *p;
+  p = _pid_get(dev);
+  if (p == NULL) {
+    return -EFAULT;
+  }
+  return sprintf(buf, "%d\n", p->task != NULL ? 1 : 0);
+}
+
+static ssize_t devAttrPidEnabled_store(struct device *dev,
+                                       struct device_attribute *attr,
+                                       const char *buf, size_t count) {
+  struct PidLoopBean *p;
+  bool val;
+  int ret;
+
+  p = _pid_get(dev);
+  if (p == NULL) {
+    return -EFAULT;
+  }
+  ret = kstrtobool(buf, &val);
+  if (ret < 0) {
+    return ret;
+  }
+
+  mutex_lock(&_pid_mtx);
+  _pid_stop(p);
+  ret = val ? _pid_start(p) : 0;
+  mutex_unlock(&_pid_mtx);
+
+  if (ret < 0) {
+    return ret;
+  }
+  return count;
+}
+
+static ssize_t devAttrPidInput_show(struct device *dev,
+                                    struct device_attribute *attr, char *buf) {
+  struct PidLoopBean *p;
+  p = _pid_get(dev);
+  if (p == NULL) {
+    return -EFAULT;
+  }
+  if (p->inExpbIdx < 0 || p->inChannel < 0) {
+    return sprintf(buf, "-\n");
+  }
+  return sprintf(buf, "%d %s\n", p->inExpbIdx + 1, AIN_CHANNELS[p->inChannel]);
+}
+
+static ssize_t devAttrPidInput_store(struct device *dev,
+                                     struct device_attribute *attr,
+                                     const char *buf, size_t count) {
+  struct PidLoopBean *p;
+  unsigned long slot;
+  char *end = NULL;
+  int8_t channel = -1;
+  int i;
+
+  p = _pid_get(dev);
+  if (p == NULL) {
+    return -EFAULT;
+  }
+
+  slot = simple_strtoul(buf, &end, 10);
+  if (slot > 4 || (slot > 0 && _expbs[slot - 1].type != X2_AIN)) {
+    return -EINVAL;
+  }
+  if (slot > 0) {
+    end = skip_spaces(end);
+    for (i = 0; i < AIN_CHANNELS_NUM; i++) {
+      if (sysfs_streq(end, AIN_CHANNELS[i])) {
+        channel = i;
+        break;
+      }
+    }
+    if (channel < 0) {
+      return -EINVAL;
+    }
+  }
+
+  mutex_lock(&_pid_mtx);
+  if (p->task != NULL) {
+    mutex_unlock(&_pid_mtx);
+    return -EBUSY;
+  }
+  p->inExpbIdx = (int8_t)slot - 1;
+  p->inChannel = channel;
+  mutex_unlock(&_pid_mtx);
+  return count;
+}
+
+static ssize_t devAttrPidOutput_show(struct device *dev,
+                                     struct device_attribute *attr, char *buf) {
+  struct PidLoopBean *p;
+  p = _pid_get(dev);
+  if (p == NULL) {
+    return -EFAULT;
+  }
+  return sprintf(buf, "%d\n", p->outChannel + 1);
+}
+
+static ssize_t devAttrPidOutput_store(struct device *dev,
+                                      struct device_attribute *attr,
+                                      const char *buf, size_t count) {
+  struct PidLoopBean *p;
+  unsigned int val;
+  int ret;
+
+  p = _pid_get(dev);
+  if (p == NULL) {
+    return -EFAULT;
+  }
+  ret = kstrtouint(buf, 10, &val);
+  if (ret < 0) {
+    return ret;
+  }
+  if (val > AOUT_CHANNELS_NUM) {
+    return -EINVAL;
+  }
+
+  mutex_lock(&_pid_mtx);
+  if (p->task != NULL) {
+    mutex_unlock(&_pid_mtx);
+    return -EBUSY;
+  }
+  p->outChannel = (int8_t)val - 1;
+  mutex_unlock(&_pid_mtx);
+  return count;
+}
+
+static ssize_t devAttrPidParam_show(struct device *dev,
+                                    struct device_attribute *attr, char *buf) {
+  struct DeviceAttrBean *dab;
+  struct PidLoopBean *p;
+
+  dab = container_of(attr, struct DeviceAttrBean, devAttr);
+  p = _pid_get(dev);
+  if (p == NULL || dab->regSpecs.reg >= PID_PARAMS_NUM) {
+    return -EFAULT;
+  }
+  return sprintf(buf, "%d\n", p->params[dab->regSpecs.reg]);
+}
+
+static ssize_t devAttrPidParam_store(struct device *dev,
+                                     struct device_attribute *attr,
+                                     const char *buf, size_t count) {
+  struct DeviceAttrBean *dab;
+  struct PidLoopBean *p;
+  int val;
+  int ret;
+
+  dab = container_of(attr, struct DeviceAttrBean, devAttr);
+  p = _pid_get(dev);
+  if (p == NULL || dab->regSpecs.reg >= PID_PARAMS_NUM) {
+    return -EFAULT;
+  }
+  ret = kstrtoint(buf, 10, &val);
+  if (ret < 0) {
+    return ret;
+  }
+
+  switch (dab->regSpecs.reg) {
+    case PID_KP:
+      // fall through
+    case PID_KI:
+      // fall through
+    case PID_KD:
+      if (val < -PID_GAIN_MAX || val > PID_GAIN_MAX) {
+        return -EINVAL;
+      }
+      break;
+    case PID_OUT_MIN:
+      // fall through
+    case PID_OUT_MAX:
+      if (val < 0 || val > 0xffff) {
+        return -EINVAL;
+      }
+      break;
+    case PID_ANTI_WINDUP:
+      val = val ? 1 : 0;
+      break;
+    case PID_PERIOD:
+      if (val < PID_PERIOD_MIN_USEC || val > PID_PERIOD_MAX_USEC) {
+        return -EINVAL;
+      }
+      break;
+    default:
+      break;
+  }
+
+  mutex_lock(&_pid_mtx);
+  // the running loop must never see crossed output bounds
+  if ((dab->regSpecs.reg == PID_OUT_MIN && val > p->params[PID_OUT_MAX]) ||
+      (dab->regSpecs.reg == PID_OUT_MAX && val < p->params[PID_OUT_MIN])) {
+    mutex_unlock(&_pid_mtx);
+    return -EINVAL;
+  }
+  p->params[dab->regSpecs.reg] = val;
+  mutex_unlock(&_pid_mtx);
+  return count;
+}
+
+static ssize_t devAttrPidStat_show(struct device *dev,
+                                   struct device_attribute *attr, char *buf) {
+  struct DeviceAttrBean *dab;
+  struct PidLoopBean *p;
+  int64_t cycles;
+
+  dab = container_of(attr, struct DeviceAttrBean, devAttr);
+  p = _pid_get(dev);
+  if (p == NULL || dab->regSpecs.reg >= PID_STATS_NUM) {
+    return -EFAULT;
+  }
+  if (dab->regSpecs.reg == PID_STAT_JITTER_AVG) {
+    cycles = p->stats[PID_STAT_CYCLES];
+    return sprintf(buf, "%llu\n",
+                   cycles > 0 ? div64_u64(p->jitterSum_usec, cycles) : 0);
+  }
+  return sprintf(buf, "%lld\n", p->stats[dab->regSpecs.reg]);
+}
+
+static struct AinBoardBean *_ain_get(struct device *dev) {
+  struct DeviceData *data;
+  data = dev_get_drvdata(dev);
+  if (data == NULL || data->expbIdx < 0) {
+    return NULL;
+  }
+  return &_ainBoards[data->expbIdx];
+}
+
+static char _ain_alarm_eval(struct AinAlarmBean *a, int32_t val) {
+  int32_t *prm = a->params;
+
+  if (val == AIN_VAL_ERROR) {
+    return 'E';
+  }
+  if (val >= AIN_VAL_OVERRANGE) {
+    return 'O';
+  }
+  if (val <= AIN_VAL_UNDERRANGE) {
+    return 'U';
+  }
+  if (val > prm[ALARM_HIGH] ||
+      (a->state == 'H' && val > prm[ALARM_HIGH] - prm[ALARM_HYST])) {
+    return 'H';
+  }
+  if (val < prm[ALARM_LOW] ||
+      (a->state == 'L' && val < prm[ALARM_LOW] + prm[ALARM_HYST])) {
+    return 'L';
+  }
+  return AIN_ALARM_STATE_OK;
+}
+
+static void _ain_sample(struct SamplerBean *s) {
+  struct AinBoardBean *b;
+  struct AinAlarmBean *a;
+  int64_t raw[AIN_CHANNELS_NUM];
+  char attrName[16];
+  char value[2];
+  ktime_t now;
+  char state;
+  int idx, i;
+
+  b = container_of(s, struct AinBoardBean, sampler);
+  idx = b - _ainBoards;
+
+  if (_i2c_read_block(I2C_EXPB_IDX_TO_REG_START(idx) + AIN_REG_VAL_START,
+                      AIN_CHANNELS_NUM, 3, raw) < 0) {
+    return;
+  }
+  now = ktime_get();
+
+  mutex_lock(&b->lock);
+  for (i = 0; i < AIN_CHANNELS_NUM; i++) {
+    b->vals[i] = sign_extend32(raw[i], 23);
+    a = &b->alarms[i];
+    if (!a->params[ALARM_ENABLED]) {
+      continue;
+    }
+
+    state = _ain_alarm_eval(a, b->vals[i]);
+    if (state == a->state) {
+      a->pending = state;
+      continue;
+    }
+    if (state != a->pending) {
+      a->pending = state;
+      a->pendingSince = now;
+    }
+    if (ktime_ms_delta(now, a->pendingSince) < a->params[ALARM_DELAY]) {
+      continue;
+    }
+
+    a->state = state;
+    if (b->device != NULL) {
+      sprintf(attrName, "%s_alarm", AIN_CHANNELS[i]);
+      value[0] = state;
+      value[1] = '\0';
+      _event_notify(b->device, attrName, value);
+    }
+  }
+  mutex_unlock(&b->lock);
+}
+
+static void _ain_alarm_update(struct AinBoardBean *b) {
+  bool enabled = false;
+  int i;
+
+  for (i = 0; i < AIN_CHANNELS_NUM; i++) {
+    if (b->alarms[i].params[ALARM_ENABLED]) {
+      enabled = true;
+      break;
+    }
+  }
+
+  if (enabled && b->sampler.interval_ms > 0) {
+    _sampler_start(&b->sampler);
+  } else {
+    _sampler_stop(&b->sampler);
+  }
+}
+
+static void _ain_init(void) {
+  struct AinBoardBean *b;
+  struct AinAlarmBean *a;
+  int i, c;
+
+  for (i = 0; i < 4; i++) {
+    b = &_ainBoards[i];
+    memset(b, 0, sizeof(*b));
+    mutex_init(&b->lock);
+    _sampler_init(&b->sampler, AIN_ALARM_INTERVAL_DEFAULT_MSEC, _ain_sample);
+    for (c = 0; c < AIN_CHANNELS_NUM; c++) {
+      a = &b->alarms[c];
+      a->params[ALARM_HIGH] = AIN_VAL_OVERRANGE - 1;
+      a->params[ALARM_LOW] = AIN_VAL_UNDERRANGE + 1;
+      a->state = AIN_ALARM_STATE_OK;
+      a->pending = AIN_ALARM_STATE_OK;
+    }
+  }
+}
+
+static void _ain_stop(void) {
+  int i;
+  for (i = 0; i < 4; i++) {
+    _sampler_stop(&_ainBoards[i].sampler);
+  }
+}
+
+static ssize_t devAttrAinAlarmInterval_show(struct device *dev,
+                                            struct device_attribute *attr,
+                                            char *buf) {
+  struct AinBoardBean *b;
+  b = _ain_get(dev);
+  if (b == NULL) {
+    return -EFAULT;
+  }
+  return sprintf(buf, "%u\n", b->sampler.interval_ms);
+}
+
+static ssize_t devAttrAinAlarmInterval_store(struct device *dev,
+                                             struct device_attribute *attr,
+                                             const char *buf, size_t count) {
+  struct AinBoardBean *b;
+  unsigned int val;
+  int ret;
+
+  b = _ain_get(dev);
+  if (b == NULL) {
+    return -EFAULT;
+  }
+  ret = kstrtouint(buf, 10, &val);
+  if (ret < 0) {
+    return ret;
+  }
+  // 0 disables the alarms evaluation
+  if (val > 0 && val < AIN_ALARM_INTERVAL_MIN_MSEC) {
+    return -EINVAL;
+  }
+  _sampler_set_interval(&b->sampler, val);
+  _ain_alarm_update(b);
+  return count;
+}
+
+static ssize_t devAttrAinAlarmParam_show(struct device *dev,
+                                         struct device_attribute *attr,
+                                         char *buf) {
+  struct DeviceAttrBean *dab;
+  struct AinBoardBean *b;
+
+  dab = container_of(attr, struct DeviceAttrBean, devAttr);
+  b = _ain_get(dev);
+  if (b == NULL || dab->regSpecs.reg >= ALARM_PARAMS_NUM ||
+      dab->regSpecs.shift >= AIN_CHANNELS_NUM) {
+    return -EFAULT;
+  }
+  return sprintf(buf, "%d\n",
+                 b->alarms[dab->regSpecs.shift].params[dab->regSpecs.reg]);
+}
+
+static ssize_t devAttrAinAlarmParam_store(struct device *dev,
+                                          struct device_attribute *attr,
+                                          const char *buf, size_t count) {
+  struct DeviceAttrBean *dab;
+  struct AinBoardBean *b;
+  struct AinAlarmBean *a;
+  int val;
+  int ret;
+
+  dab = container_of(attr, struct DeviceAttrBean, devAttr);
+  b = _ain_get(dev);
+  if (b == NULL || dab->regSpecs.reg >= ALARM_PARAMS_NUM ||
+      dab->regSpecs.shift >= AIN_CHANNELS_NUM) {
+    return -EFAULT;
+  }
+  ret = kstrtoint(buf, 10, &val);
+  if (ret < 0) {
+    return ret;
+  }
+  if (dab->regSpecs.reg == ALARM_ENABLED) {
+    val = val ? 1 : 0;
+  } else if (dab->regSpecs.reg == ALARM_HYST ||
+             dab->regSpecs.reg == ALARM_DELAY) {
+    if (val < 0) {
+      return -EINVAL;
+    }
+  }
+
+  a = &b->alarms[dab->regSpecs.shift];
+  mutex_lock(&b->lock);
+  a->params[dab->regSpecs.reg] = val;
+  if (dab->regSpecs.reg == ALARM_ENABLED) {
+    a->state = AIN_ALARM_STATE_OK;
+    a->pending = AIN_ALARM_STATE_OK;
+  }
+  b->device = dev;
+  mutex_unlock(&b->lock);
+
+  _ain_alarm_update(b);
+  return count;
+}
+
+static ssize_t devAttrAinAlarm_show(struct device *dev,
+                                    struct device_attribute *attr, char *buf) {
+  struct DeviceAttrBean *dab;
+  struct AinBoardBean *b;
+
+  dab = container_of(attr, struct DeviceAttrBean, devAttr);
+  b = _ain_get(dev);
+  if (b == NULL || dab->regSpecs.shift >= AIN_CHANNELS_NUM) {
+    return -EFAULT;
+  }
+  return sprintf(buf, "%c\n", b->alarms[dab->regSpecs.shift].state);
+}
+
+static void _ain_sync_push(struct AinSyncRecord *rec) {
+  unsigned long flags;
+
+  spin_lock_irqsave(&_ainSync.ringLock, flags);
+  if (_ainSync.head - _ainSync.tail >= AIN_SYNC_RING_SIZE) {
+    // full: drop the oldest record
+    _ainSync.tail++;
+    _ainSync.stats[AIN_SYNC_STAT_DROPPED]++;
+  }
+  _ainSync.ring[_ainSync.head % AIN_SYNC_RING_SIZE] = *rec;
+  _ainSync.head++;
+  spin_unlock_irqrestore(&_ainSync.ringLock, flags);
+}
+
+static void _ain_sync_tick(void) {
+  int64_t raw[4][AIN_CHANNELS_NUM];
+  struct AinSyncRecord rec;
+  bool member[4];
+  bool valid[4];
+  ktime_t t0, t1;
+  int64_t res;
+  int i, c;
+
+  t0 = ktime_get();
+  for (i = 0; i < 4; i++) {
+    member[i] = _ainBoards[i].syncEnabled;
+    valid[i] = false;
+    if (!member[i]) {
+      continue;
+    }
+    // the bus is released between boards to let other accesses through
+    if (!_i2c_lock()) {
+      continue;
+    }
+    valid[i] = true;
+    for (c = 0; c < AIN_CHANNELS_NUM; c++) {
+      res = _i2c_read_no_lock(
+          I2C_EXPB_IDX_TO_REG_START(i) + AIN_REG_VAL_START + c, 3);
+      if (res < 0) {
+        valid[i] = false;
+        break;
+      }
+      raw[i][c] = res;
+    }
+    _i2c_unlock();
+  }
+  t1 = ktime_get();
+
+  memset(&rec, 0, sizeof(rec));
+  rec.timestamp_ns = ktime_to_ns(t0);
+  rec.seq = (uint32_t)_ainSync.stats[AIN_SYNC_STAT_SEQ]++;
+  rec.span_us = ktime_us_delta(t1, t0);
+  for (i = 0; i < 4; i++) {
+    if (!member[i]) {
+      continue;
+    }
+    rec.slot = i + 1;
+    rec.valid = valid[i] ? 1 : 0;
+    if (valid[i]) {
+      mutex_lock(&_ainBoards[i].lock);
+      for (c = 0; c < AIN_CHANNELS_NUM; c++) {
+        rec.vals[c] = sign_extend32(raw[i][c], 23);
+        _ainBoards[i].vals[c] = rec.vals[c];
+      }
+      mutex_unlock(&_ainBoards[i].lock);
+    } else {
+      _ainSync.stats[AIN_SYNC_STAT_ERRORS]++;
+      memset(rec.vals, 0, sizeof(rec.vals));
+    }
+    _ain_sync_push(&rec);
+  }
+  wake_up_interruptible(&_ainSync.wq);
+}
+
+static unsigned int _ain_sync_interval(void) {
+  unsigned int interval, n = 0;
+  int i;
+
+  for (i = 0; i < 4; i++) {
+    if (_ainBoards[i].syncEnabled) {
+      n++;
+    }
+  }
+  // never shorter than the time the tick takes on the bus
+  interval = READ_ONCE(_ainSync.interval_usec);
+  return max(interval, n * AIN_SYNC_BOARD_USEC);
+}
+
+static int _ain_sync_thread(void *arg) {
+  unsigned int interval;
+  ktime_t next, now;
+
+  next = ktime_get();
+  while (!kthread_should_stop()) {
+    interval = _ain_sync_interval();
+    next = ktime_add_us(next, interval);
+    set_current_state(TASK_INTERRUPTIBLE);
+    if (kthread_should_stop()) {
+      __set_current_state(TASK_RUNNING);
+      break;
+    }
+    schedule_hrtimeout(&next, HRTIMER_MODE_ABS);
+
+    _ain_sync_tick();
+
+    now = ktime_get();
+    if (ktime_after(now, ktime_add_us(next, interval))) {
+      _ainSync.stats[AIN_SYNC_STAT_OVERRUNS]++;
+      next = now;
+    }
+  }
+  return 0;
+}
+
+static int _ain_sync_update(void) {
+  struct task_struct *task;
+  bool enabled = false;
+  int i;
+
+  for (i = 0; i < 4; i++) {
+    if (_ainBoards[i].syncEnabled) {
+      enabled = true;
+      break;
+    }
+  }
+
+  if (!enabled) {
+    if (_ainSync.task != NULL) {
+      kthread_stop(_ainSync.task);
+      _ainSync.task = NULL;
+    }
+    return 0;
+  }
+
+  if (_ainSync.task == NULL) {
+    task = kthread_run(_ain_sync_thread, NULL, "stratopimax_ain_sync");
+    if (IS_ERR(task)) {
+      return PTR_ERR(task);
+    }
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 9, 0)
+    sched_set_fifo_low(task);
+#endif
+    _ainSync.task = task;
+  }
+  return 0;
+}
+
+static int _ain_sync_open(struct inode *inode, struct file *file) {
+  mutex_lock(&_ainSync.lock);
+  if (_ainSync.open) {
+    mutex_unlock(&_ainSync.lock);
+    return -EBUSY;
+  }
+  _ainSync.open = true;
+  mutex_unlock(&_ainSync.lock);
+  return nonseekable_open(inode, file);
+}
+
+static int _ain_sync_release(struct inode *inode, struct file *file) {
+  mutex_lock(&_ainSync.lock);
+  _ainSync.open = false;
+  mutex_unlock(&_ainSync.lock);
+  return 0;
+}
+
+static ssize_t _ain_sync_read(struct file *file, char __user *buf,
+                              size_t count, loff_t *ppos) {
+  struct AinSyncRecord rec;
+  unsigned long flags;
+  ssize_t done = 0;
+  int ret;
+
+  if (count < sizeof(rec)) {
+    return -EINVAL;
+  }
+
+  if (_ainSync.head == _ainSync.tail) {
+    if (file->f_flags & O_NONBLOCK) {
+      return -EAGAIN;
+    }
+    ret = wait_event_interruptible(_ainSync.wq,
+                                   _ainSync.head != _ainSync.tail);
+    if (ret < 0) {
+      return ret;
+    }
+  }
 
-    {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "ai3_sps",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = 22,
-                .len = 4,
-                .mask = 0xffff,
-                .shift = 0,
-                .sign = true,
-            },
-    },
+  while (count - done >= sizeof(rec)) {
+    spin_lock_irqsave(&_ainSync.ringLock, flags);
+    if (_ainSync.head == _ainSync.tail) {
+      spin_unlock_irqrestore(&_ainSync.ringLock, flags);
+      break;
+    }
+    rec = _ainSync.ring[_ainSync.tail % AIN_SYNC_RING_SIZE];
+    _ainSync.tail++;
+    spin_unlock_irqrestore(&_ainSync.ringLock, flags);
+
+    if (copy_to_user(buf + done, &rec, sizeof(rec))) {
+      return done > 0 ? done : -EFAULT;
+    }
+    done += sizeof(rec);
+  }
+
+  return done;
+}
+
+static __poll_t _ain_sync_poll(struct file *file,
+                               struct poll_table_struct *wait) {
+  poll_wait(file, &_ainSync.wq, wait);
+  if (_ainSync.head != _ainSync.tail) {
+    return EPOLLIN | EPOLLRDNORM;
+  }
+  return 0;
+}
+
+static const struct file_operations _ainSyncFops = {
+    .owner = THIS_MODULE,
+    .open = _ain_sync_open,
+    .release = _ain_sync_release,
+    .read = _ain_sync_read,
+    .poll = _ain_sync_poll,
+};
+
+static struct miscdevice _ainSyncMisc = {
+    .minor = MISC_DYNAMIC_MINOR,
+    .name = "stratopimax_ain_sync",
+    .fops = &_ainSyncFops,
+    .mode = 0440,
+};
+
+static void _ain_sync_init(void) {
+  memset(&_ainSync, 0, sizeof(_ainSync));
+  mutex_init(&_ainSync.lock);
+  spin_lock_init(&_ainSync.ringLock);
+  init_waitqueue_head(&_ainSync.wq);
+  _ainSync.interval_usec = AIN_SYNC_INTERVAL_DEFAULT_USEC;
+}
+
+static void _ain_sync_register(void) {
+  int i;
+
+  for (i = 0; i < 4; i++) {
+    if (_expbs[i].type == X2_AIN) {
+      if (misc_register(&_ainSyncMisc)) {
+        pr_err(LOG_TAG "failed to register %s\n", _ainSyncMisc.name);
+      } else {
+        _ainSyncRegistered = true;
+      }
+      break;
+    }
+  }
+}
+
+static void _ain_sync_stop(void) {
+  int i;
+
+  mutex_lock(&_ainSync.lock);
+  for (i = 0; i < 4; i++) {
+    _ainBoards[i].syncEnabled = false;
+  }
+  _ain_sync_update();
+  mutex_unlock(&_ainSync.lock);
+
+  if (_ainSyncRegistered) {
+    misc_deregister(&_ainSyncMisc);
+    _ainSyncRegistered = false;
+  }
+}
+
+static ssize_t devAttrAinSyncEnabled_show(struct device *dev,
+                                          struct device_attribute *attr,
+                                          char *buf) {
+  struct AinBoardBean *b;
+  b = _ain_get(dev);
+  if (b == NULL) {
+    return -EFAULT;
+  }
+  return sprintf(buf, "%d\n", b->syncEnabled ? 1 : 0);
+}
+
+static ssize_t devAttrAinSyncEnabled_store(struct device *dev,
+                                           struct device_attribute *attr,
+                                           const char *buf, size_t count) {
+  struct AinBoardBean *b;
+  bool val;
+  int ret;
+
+  b = _ain_get(dev);
+  if (b == NULL) {
+    return -EFAULT;
+  }
+  ret = kstrtobool(buf, &val);
+  if (ret < 0) {
+    return ret;
+  }
+
+  mutex_lock(&_ainSync.lock);
+  b->syncEnabled = val;
+  ret = _ain_sync_update();
+  if (ret < 0) {
+    b->syncEnabled = false;
+  }
+  mutex_unlock(&_ainSync.lock);
+
+  if (ret < 0) {
+    return ret;
+  }
+  return count;
+}
+
+static ssize_t devAttrAinSyncInterval_show(struct device *dev,
+                                           struct device_attribute *attr,
+                                           char *buf) {
+  return sprintf(buf, "%u\n", _ainSync.interval_usec);
+}
+
+static ssize_t devAttrAinSyncInterval_store(struct device *dev,
+                                            struct device_attribute *attr,
+                                            const char *buf, size_t count) {
+  unsigned int val;
+  int ret;
+
+  ret = kstrtouint(buf, 10, &val);
+  if (ret < 0) {
+    return ret;
+  }
+  if (val < AIN_SYNC_BOARD_USEC) {
+    return -EINVAL;
+  }
+  WRITE_ONCE(_ainSync.interval_usec, val);
+  return count;
+}
+
+static ssize_t devAttrAinSyncStat_show(struct device *dev,
+                                       struct device_attribute *attr,
+                                       char *buf) {
+  struct DeviceAttrBean *dab;
+  dab = container_of(attr, struct DeviceAttrBean, devAttr);
+  if (dab->regSpecs.reg >= AIN_SYNC_STATS_NUM) {
+    return -EFAULT;
+  }
+  return sprintf(buf, "%llu\n", _ainSync.stats[dab->regSpecs.reg]);
+}
+
+static int8_t _expb_find(const uint8_t *types) {
+  int i, t;
+  for (i = 0; i < 4; i++) {
+    for (t = 0; types[t] != 0; t++) {
+      if (_expbs[i].type == types[t]) {
+        return i;
+      }
+    }
+  }
+  return -1;
+}
+
+static void _energy_sample(struct SamplerBean *s) {
+  int64_t vals[2];
+  uint64_t power, e;
+  uint32_t rem;
+  ktime_t now;
+  int64_t dt_usec;
+
+  if (_i2c_read_block(I2C_REG_SYSMON_VIN_V, 2, 2, vals) < 0) {
+    return;
+  }
+  now = ktime_get();
+  // mV * mA = µW
+  power = vals[0] * vals[1];
+
+  spin_lock(&_energy.lock);
+  if (_energy.valid) {
+    dt_usec = ktime_us_delta(now, _energy.last);
+    // trapezoidal rule, µW * µs = pJ
+    e = (power + _energy.power) * dt_usec / 2 + _energy.rem_pJ;
+    _energy.energy_uJ += div_u64_rem(e, 1000000, &rem);
+    _energy.rem_pJ = rem;
+  }
+  _energy.last = now;
+  _energy.vin_mV = vals[0];
+  _energy.vin_mA = vals[1];
+  _energy.power = power;
+  _energy.valid = true;
+  if (power > _energy.peak_uW) {
+    _energy.peak_uW = power;
+  }
+  spin_unlock(&_energy.lock);
+}
+
+static uint64_t _energy_get_uJ(void) {
+  uint64_t val;
+
+  spin_lock(&_energy.lock);
+  val = _energy.energy_uJ;
+  spin_unlock(&_energy.lock);
+  return val;
+}
+
+static uint64_t _energy_get_peak_uW(void) {
+  uint64_t val;
+
+  spin_lock(&_energy.lock);
+  val = _energy.peak_uW;
+  spin_unlock(&_energy.lock);
+  return val;
+}
+
+static bool _energy_get_vin(int32_t *mV, int32_t *mA) {
+  bool valid;
+
+  spin_lock(&_energy.lock);
+  valid = _energy.valid;
+  *mV = _energy.vin_mV;
+  *mA = _energy.vin_mA;
+  spin_unlock(&_energy.lock);
+  return valid;
+}
+
+static void _energy_reset_peak(void) {
+  spin_lock(&_energy.lock);
+  _energy.peak_uW = _energy.power;
+  spin_unlock(&_energy.lock);
+}
+
+static void _energy_init(void) {
+  spin_lock_init(&_energy.lock);
+  _sampler_init(&_energy.sampler, ENERGY_INTERVAL_DEFAULT_MSEC, _energy_sample);
+}
+
+static ssize_t devAttrEnergy_show(struct device *dev,
+                                  struct device_attribute *attr, char *buf) {
+  // µJ => mWh
+  return sprintf(buf, "%llu\n", div_u64(_energy_get_uJ(), 3600000));
+}
+
+static ssize_t devAttrEnergy_store(struct device *dev,
+                                   struct device_attribute *attr,
+                                   const char *buf, size_t count) {
+  unsigned long long val;
+  int ret;
+
+  ret = kstrtoull(buf, 10, &val);
+  if (ret < 0) {
+    return ret;
+  }
+  if (val > U64_MAX / 3600000) {
+    return -EINVAL;
+  }
+
+  spin_lock(&_energy.lock);
+  // mWh => µJ
+  _energy.energy_uJ = val * 3600000;
+  _energy.rem_pJ = 0;
+  spin_unlock(&_energy.lock);
+  return count;
+}
+
+static ssize_t devAttrEnergyPeak_show(struct device *dev,
+                                      struct device_attribute *attr,
+                                      char *buf) {
+  // µW => mW
+  return sprintf(buf, "%llu\n", div_u64(_energy_get_peak_uW(), 1000));
+}
+
+static ssize_t devAttrEnergyPeak_store(struct device *dev,
+                                       struct device_attribute *attr,
+                                       const char *buf, size_t count) {
+  _energy_reset_peak();
+  return count;
+}
+
+static ssize_t devAttrEnergyInterval_show(struct device *dev,
+                                          struct device_attribute *attr,
+                                          char *buf) {
+  return sprintf(buf, "%u\n", _energy.sampler.interval_ms);
+}
+
+static ssize_t devAttrEnergyInterval_store(struct device *dev,
+                                           struct device_attribute *attr,
+                                           const char *buf, size_t count) {
+  unsigned int val;
+  int ret;
+
+  ret = kstrtouint(buf, 10, &val);
+  if (ret < 0) {
+    return ret;
+  }
+  if (val < ENERGY_INTERVAL_MIN_MSEC || val > ENERGY_INTERVAL_MAX_MSEC) {
+    return -EINVAL;
+  }
+  _sampler_set_interval(&_energy.sampler, val);
+  return count;
+}
+
+static void _hwmon_set(enum HwmonVal v, int32_t val) {
+  _hwmon.vals[v] = val;
+  set_bit(v, &_hwmon.validMask);
+}
+
+static void _hwmon_sample(struct SamplerBean *s) {
+  int64_t vals[2];
+  int32_t temp, mV, mA;
+
+  if (_lm75a_read(LM75A_REG_TEMP, LM75A_MASK_TEMP, &temp) == 0) {
+    _hwmon_set(HWMON_TEMP, temp);
+  }
+  if (_fan_threshold_read(LM75A_REG_TOS, &temp) == 0) {
+    _hwmon_set(HWMON_TEMP_MAX, temp);
+  }
+  if (_fan_threshold_read(LM75A_REG_THYST, &temp) == 0) {
+    _hwmon_set(HWMON_TEMP_HYST, temp);
+  }
+
+  // input V/I are already polled by the energy sampler
+  if (_energy_get_vin(&mV, &mA)) {
+    _hwmon_set(HWMON_VIN_V, mV);
+    _hwmon_set(HWMON_VIN_I, mA);
+  }
+
+  if (_hwmon.upsExpbIdx >= 0) {
+    if (_i2c_read_block(I2C_EXPB_IDX_TO_REG_START(_hwmon.upsExpbIdx) +
+                            I2C_REG_OFST_UPS_VBAT_V,
+                        2, 2, vals) == 0) {
+      _hwmon_set(HWMON_UPS_V, vals[0]);
+      _hwmon_set(HWMON_UPS_I, vals[1]);
+    }
+  }
+}
+
+static int _hwmon_get(enum HwmonVal v, long *val) {
+  if (!test_bit(v, &_hwmon.validMask)) {
+    return -ENODATA;
+  }
+  *val = _hwmon.vals[v];
+  return 0;
+}
+
+static umode_t _hwmon_is_visible(const void *data,
+                                 enum hwmon_sensor_types type, u32 attr,
+                                 int channel) {
+  switch (type) {
+    case hwmon_chip:
+      return 0644;
+    case hwmon_temp:
+      if (attr == hwmon_temp_input) {
+        return 0444;
+      }
+      return 0644;
+    case hwmon_in:
+      // fall through
+    case hwmon_curr:
+      if (channel == 1 && _hwmon.upsExpbIdx < 0) {
+        return 0;
+      }
+      return 0444;
+    case hwmon_power:
+      if (attr == hwmon_power_reset_history) {
+        return 0200;
+      }
+      return 0444;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 11, 0)
+    case hwmon_energy64:
+      return 0444;
+#endif
+    case hwmon_energy:
+      return 0444;
+    default:
+      return 0;
+  }
+}
+
+static int _hwmon_read(struct device *dev, enum hwmon_sensor_types type,
+                       u32 attr, int channel, long *val) {
+  long v, i;
+  int res;
+
+  switch (type) {
+    case hwmon_chip:
+      *val = _hwmon.sampler.interval_ms;
+      return 0;
+    case hwmon_temp:
+      switch (attr) {
+        case hwmon_temp_input:
+          res = _hwmon_get(HWMON_TEMP, val);
+          break;
+        case hwmon_temp_max:
+          res = _hwmon_get(HWMON_TEMP_MAX, val);
+          break;
+        case hwmon_temp_max_hyst:
+          res = _hwmon_get(HWMON_TEMP_HYST, val);
+          break;
+        default:
+          return -EOPNOTSUPP;
+      }
+      // °C/100 => m°C
+      if (res == 0) {
+        *val *= 10;
+      }
+      return res;
+    case hwmon_in:
+      return _hwmon_get(channel == 0 ? HWMON_VIN_V : HWMON_UPS_V, val);
+    case hwmon_curr:
+      return _hwmon_get(channel == 0 ? HWMON_VIN_I : HWMON_UPS_I, val);
+    case hwmon_power:
+      if (attr == hwmon_power_input_highest) {
+        if (!_energy.valid) {
+          return -ENODATA;
+        }
+        *val = _energy_get_peak_uW();
+        return 0;
+      }
+      res = _hwmon_get(HWMON_VIN_V, &v);
+      if (res == 0) {
+        res = _hwmon_get(HWMON_VIN_I, &i);
+      }
+      if (res == 0) {
+        // mV * mA = µW
+        *val = v * i;
+      }
+      return res;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 11, 0)
+    case hwmon_energy64:
+      if (!_energy.valid) {
+        return -ENODATA;
+      }
+      // val points to a s64 for the 64-bit energy type
+      *(s64 *)val = _energy_get_uJ();
+      return 0;
+#endif
+    case hwmon_energy:
+      if (!_energy.valid) {
+        return -ENODATA;
+      }
+      // saturates at about 0.6 Wh where long is 32-bit
+      *val = min_t(uint64_t, _energy_get_uJ(), LONG_MAX);
+      return 0;
+    default:
+      return -EOPNOTSUPP;
+  }
+}
+
+static int _hwmon_read_string(struct device *dev,
+                              enum hwmon_sensor_types type, u32 attr,
+                              int channel, const char **str) {
+  *str = channel == 0 ? "vin" : "ups";
+  return 0;
+}
+
+static int _hwmon_write(struct device *dev, enum hwmon_sensor_types type,
+                        u32 attr, int channel, long val) {
+  int32_t res;
+
+  switch (type) {
+    case hwmon_chip:
+      if (val < HWMON_INTERVAL_MIN_MSEC) {
+        return -EINVAL;
+      }
+      _sampler_set_interval(&_hwmon.sampler, val);
+      return 0;
+    case hwmon_temp:
+      // m°C => °C/100
+      val /= 10;
+      if (attr == hwmon_temp_max) {
+        res = _fan_threshold_write(LM75A_REG_TOS, val);
+        if (res == 0) {
+          _hwmon.vals[HWMON_TEMP_MAX] = val;
+        }
+      } else {
+        res = _fan_threshold_write(LM75A_REG_THYST, val);
+        if (res == 0) {
+          _hwmon.vals[HWMON_TEMP_HYST] = val;
+        }
+      }
+      return res;
+    case hwmon_power:
+      _energy_reset_peak();
+      return 0;
+    default:
+      return -EOPNOTSUPP;
+  }
+}
+
+static const struct hwmon_ops _hwmonOps = {
+    .is_visible = _hwmon_is_visible,
+    .read = _hwmon_read,
+    .read_string = _hwmon_read_string,
+    .write = _hwmon_write,
+};
+
+static const struct hwmon_channel_info *const _hwmonInfo[] = {
+    HWMON_CHANNEL_INFO(chip, HWMON_C_UPDATE_INTERVAL),
+    HWMON_CHANNEL_INFO(temp, HWMON_T_INPUT | HWMON_T_MAX | HWMON_T_MAX_HYST),
+    HWMON_CHANNEL_INFO(in, HWMON_I_INPUT | HWMON_I_LABEL,
+                       HWMON_I_INPUT | HWMON_I_LABEL),
+    HWMON_CHANNEL_INFO(curr, HWMON_C_INPUT | HWMON_C_LABEL,
+                       HWMON_C_INPUT | HWMON_C_LABEL),
+    HWMON_CHANNEL_INFO(power, HWMON_P_INPUT | HWMON_P_LABEL |
+                                  HWMON_P_INPUT_HIGHEST |
+                                  HWMON_P_RESET_HISTORY),
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 11, 0)
+    HWMON_CHANNEL_INFO(energy64, HWMON_E_INPUT | HWMON_E_LABEL),
+#else
+    HWMON_CHANNEL_INFO(energy, HWMON_E_INPUT | HWMON_E_LABEL),
+#endif
+    NULL,
+};
+
+static const struct hwmon_chip_info _hwmonChipInfo = {
+    .ops = &_hwmonOps,
+    .info = _hwmonInfo,
+};
+
+static void _hwmon_init(void) {
+  _sampler_init(&_hwmon.sampler, HWMON_INTERVAL_DEFAULT_MSEC, _hwmon_sample);
+}
+
+static void _hwmon_register(struct platform_device *pdev) {
+  struct device *dev;
+
+  _hwmon.upsExpbIdx = _expb_find(devUpsBatteryExpbTypes);
+
+  dev = hwmon_device_register_with_info(&pdev->dev, "stratopimax", NULL,
+                                        &_hwmonChipInfo, NULL);
+  if (IS_ERR(dev)) {
+    pr_err(LOG_TAG "failed to register hwmon device\n");
+    return;
+  }
+  _hwmon.device = dev;
+  _sampler_start(&_hwmon.sampler);
+}
+
+static void _hwmon_unregister(void) {
+  _sampler_stop(&_hwmon.sampler);
+  if (_hwmon.device != NULL) {
+    hwmon_device_unregister(_hwmon.device);
+    _hwmon.device = NULL;
+  }
+}
+
+static int _fan_set_state(unsigned long state) {
+  int32_t res = 0;
+
+  mutex_lock(&_fan.lock);
+  if (state == _fan.state) {
+    goto out;
+  }
+
+  if (state) {
+    res = _lm75a_read(LM75A_REG_TOS, LM75A_MASK_THRESHOLD, &_fan.savedOn);
+    if (res == 0) {
+      res = _lm75a_read(LM75A_REG_THYST, LM75A_MASK_THRESHOLD,
+                        &_fan.savedOff);
+    }
+    if (res == 0) {
+      res = _lm75a_write(LM75A_REG_TOS, LM75A_MASK_THRESHOLD,
+                         LM75A_TEMP_MIN + 50);
+    }
+    if (res == 0) {
+      res = _lm75a_write(LM75A_REG_THYST, LM75A_MASK_THRESHOLD,
+                         LM75A_TEMP_MIN);
+    }
+  } else {
+    res = _lm75a_write(LM75A_REG_THYST, LM75A_MASK_THRESHOLD, _fan.savedOff);
+    if (res == 0) {
+      res = _lm75a_write(LM75A_REG_TOS, LM75A_MASK_THRESHOLD, _fan.savedOn);
+    }
+  }
+
+  if (res == 0) {
+    _fan.state = state;
+  }
+
+out:
+  mutex_unlock(&_fan.lock);
+  return res;
+}
+
+static void _fan_sample(struct SamplerBean *s) {
+  struct thermal_zone_device *cpuTz;
+  int32_t temp;
+  int cpuTemp;
+
+  if (_lm75a_read(LM75A_REG_TEMP, LM75A_MASK_TEMP, &temp) < 0) {
+    return;
+  }
+  // °C/100 => m°C
+  temp *= 10;
+
+  if (_fan.cpuOffset >= 0) {
+    cpuTz = thermal_zone_get_zone_by_name(FAN_CPU_THERMAL_ZONE);
+    if (!IS_ERR(cpuTz) && thermal_zone_get_temp(cpuTz, &cpuTemp) == 0) {
+      cpuTemp -= _fan.cpuOffset * 10;
+      if (cpuTemp > temp) {
+        temp = cpuTemp;
+      }
+    }
+  }
+
+  _fan.temp = temp;
+  _fan.tempValid = true;
+
+  if (_fan.tz != NULL) {
+    thermal_zone_device_update(_fan.tz, THERMAL_EVENT_UNSPECIFIED);
+  }
+}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 1, 0)
+static int _fan_tz_get_temp(struct thermal_zone_device *tz, int *temp) {
+  if (!_fan.tempValid) {
+    return -EAGAIN;
+  }
+  *temp = _fan.temp;
+  return 0;
+}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 12, 0)
+static bool _fan_tz_should_bind(struct thermal_zone_device *tz,
+                                const struct thermal_trip *trip,
+                                struct thermal_cooling_device *cdev,
+                                struct cooling_spec *c) {
+  return cdev == _fan.cdev;
+}
+#else
+static int _fan_tz_bind(struct thermal_zone_device *tz,
+                        struct thermal_cooling_device *cdev) {
+  if (cdev != _fan.cdev) {
+    return 0;
+  }
+  return thermal_zone_bind_cooling_device(tz, 0, cdev, THERMAL_NO_LIMIT,
+                                          THERMAL_NO_LIMIT,
+                                          THERMAL_WEIGHT_DEFAULT);
+}
+
+static int _fan_tz_unbind(struct thermal_zone_device *tz,
+                          struct thermal_cooling_device *cdev) {
+  if (cdev != _fan.cdev) {
+    return 0;
+  }
+  return thermal_zone_unbind_cooling_device(tz, 0, cdev);
+}
+#endif
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6, 10, 0)
+static int _fan_tz_set_trip_temp(struct thermal_zone_device *tz, int trip,
+                                 int temp) {
+  // the trip temperature is updated by the thermal core
+  return 0;
+}
+#endif
+
+static struct thermal_zone_device_ops _fanTzOps = {
+    .get_temp = _fan_tz_get_temp,
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 12, 0)
+    .should_bind = _fan_tz_should_bind,
+#else
+    .bind = _fan_tz_bind,
+    .unbind = _fan_tz_unbind,
+#endif
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6, 10, 0)
+    .set_trip_temp = _fan_tz_set_trip_temp,
+#endif
+};
 
+static struct thermal_trip _fanTrips[] = {
     {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "ai4_sps",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = 22,
-                .len = 4,
-                .mask = 0xffff,
-                .shift = 16,
-                .sign = true,
-            },
+        .temperature = FAN_TRIP_TEMP_DEFAULT,
+        .hysteresis = FAN_TRIP_HYST_DEFAULT,
+        .type = THERMAL_TRIP_ACTIVE,
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 10, 0)
+        .flags = THERMAL_TRIP_FLAG_RW_TEMP | THERMAL_TRIP_FLAG_RW_HYST,
+#endif
     },
+};
 
-    {},
+// sensors are already exported by our own hwmon device
+static struct thermal_zone_params _fanTzParams = {
+    .no_hwmon = true,
 };
 
-static struct DeviceAttrBean devAttrBeansAOut[] = {
-    {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "ao%d_mode_config",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 0,
-                .len = 2,
-                .mask = 0x1,
-                .shift = 1,
-                .sign = false,
-            },
-        .bitMapLen = 4,
-        .bitMapStart = 0,
-        .vals = VALS_AOUT_MODE,
-    },
+static int _fan_cdev_get_max_state(struct thermal_cooling_device *cdev,
+                                   unsigned long *state) {
+  *state = 1;
+  return 0;
+}
 
-    {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "ao1",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 6,
-                .len = 2,
-                .mask = 0,
-                .shift = 0,
-                .sign = false,
-            },
-    },
+static int _fan_cdev_get_cur_state(struct thermal_cooling_device *cdev,
+                                   unsigned long *state) {
+  *state = _fan.state;
+  return 0;
+}
 
-    {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "ao2",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 7,
-                .len = 2,
-                .mask = 0,
-                .shift = 0,
-                .sign = false,
-            },
-    },
+static int _fan_cdev_set_cur_state(struct thermal_cooling_device *cdev,
+                                   unsigned long state) {
+  return _fan_set_state(state ? 1 : 0);
+}
 
-    {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "ao3",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 8,
-                .len = 2,
-                .mask = 0,
-                .shift = 0,
-                .sign = false,
-            },
-    },
+static const struct thermal_cooling_device_ops _fanCdevOps = {
+    .get_max_state = _fan_cdev_get_max_state,
+    .get_cur_state = _fan_cdev_get_cur_state,
+    .set_cur_state = _fan_cdev_set_cur_state,
+};
 
-    {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "ao4",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 9,
-                .len = 2,
-                .mask = 0,
-                .shift = 0,
-                .sign = false,
-            },
-    },
+static void _fan_thermal_register(void) {
+  struct thermal_cooling_device *cdev;
+  struct thermal_zone_device *tz;
 
-    {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "ao%d_errs",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = 10,
-                .len = 2,
-                .mask = 0b111,
-                .shift = 4,
-                .sign = false,
-                .base = 2,
-            },
-        .bitMapLen = 4,
-        .bitMapStart = 0,
-    },
+  cdev = thermal_cooling_device_register("stratopimax-fan", NULL,
+                                         &_fanCdevOps);
+  if (IS_ERR(cdev)) {
+    pr_err(LOG_TAG "failed to register fan cooling device\n");
+    return;
+  }
+  _fan.cdev = cdev;
 
-    {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "v5_fault",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = 10,
-                .len = 2,
-                .mask = 1,
-                .shift = 15,
-                .sign = false,
-            },
-    },
+  // polled by our sampler, not by the thermal core
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 10, 0)
+  tz = thermal_zone_device_register_with_trips(
+      "stratopimax", _fanTrips, ARRAY_SIZE(_fanTrips), NULL, &_fanTzOps,
+      &_fanTzParams, 0, 0);
+#else
+  tz = thermal_zone_device_register_with_trips(
+      "stratopimax", _fanTrips, ARRAY_SIZE(_fanTrips), 1, NULL, &_fanTzOps,
+      &_fanTzParams, 0, 0);
+#endif
+  if (IS_ERR(tz)) {
+    pr_err(LOG_TAG "failed to register thermal zone\n");
+    return;
+  }
+  _fan.tz = tz;
 
-    {},
+  if (thermal_zone_device_enable(tz)) {
+    pr_err(LOG_TAG "failed to enable thermal zone\n");
+  }
+}
+
+static void _fan_thermal_unregister(void) {
+  if (_fan.tz != NULL) {
+    thermal_zone_device_unregister(_fan.tz);
+    _fan.tz = NULL;
+  }
+  if (_fan.cdev != NULL) {
+    thermal_cooling_device_unregister(_fan.cdev);
+    _fan.cdev = NULL;
+  }
+}
+#else
+static void _fan_thermal_register(void) {}
+
+static void _fan_thermal_unregister(void) {}
+#endif
+
+static void _fan_init(void) {
+  mutex_init(&_fan.lock);
+  _fan.cpuOffset = FAN_CPU_OFFSET_DEFAULT;
+  _sampler_init(&_fan.sampler, FAN_INTERVAL_DEFAULT_MSEC, _fan_sample);
+}
+
+static void _fan_register(void) {
+  _fan_thermal_register();
+  _sampler_start(&_fan.sampler);
+}
+
+static void _fan_unregister(void) {
+  _sampler_stop(&_fan.sampler);
+  _fan_thermal_unregister();
+  // give control back to the temp_on/temp_off thresholds
+  _fan_set_state(0);
+}
+
+static ssize_t devAttrFanThermalInterval_show(struct device *dev,
+                                              struct device_attribute *attr,
+                                              char *buf) {
+  return sprintf(buf, "%u\n", _fan.sampler.interval_ms);
+}
+
+static ssize_t devAttrFanThermalInterval_store(struct device *dev,
+                                               struct device_attribute *attr,
+                                               const char *buf,
+                                               size_t count) {
+  unsigned int val;
+  int ret;
+
+  ret = kstrtouint(buf, 10, &val);
+  if (ret < 0) {
+    return ret;
+  }
+  if (val < FAN_INTERVAL_MIN_MSEC) {
+    return -EINVAL;
+  }
+  _sampler_set_interval(&_fan.sampler, val);
+  return count;
+}
+
+static ssize_t devAttrFanThermalCpuOffset_show(struct device *dev,
+                                               struct device_attribute *attr,
+                                               char *buf) {
+  return sprintf(buf, "%d\n", _fan.cpuOffset);
+}
+
+static ssize_t devAttrFanThermalCpuOffset_store(struct device *dev,
+                                                struct device_attribute *attr,
+                                                const char *buf,
+                                                size_t count) {
+  int val;
+  int ret;
+
+  ret = kstrtoint(buf, 10, &val);
+  if (ret < 0) {
+    return ret;
+  }
+  if (val < -1 || val > LM75A_TEMP_MAX - LM75A_TEMP_MIN) {
+    return -EINVAL;
+  }
+  _fan.cpuOffset = val;
+  return count;
+}
+
+static void _wdt_pretimer_restart(struct watchdog_device *wdd) {
+  _wdt.lastPing = ktime_get();
+  hrtimer_cancel(&_wdt.preTimer);
+  if (wdd->pretimeout > 0 && wdd->pretimeout < wdd->timeout) {
+    hrtimer_start(&_wdt.preTimer,
+                  ktime_set(wdd->timeout - wdd->pretimeout, 0),
+                  HRTIMER_MODE_REL);
+  }
+}
+
+static enum hrtimer_restart _wdt_pretimer_handler(struct hrtimer *tmr) {
+  watchdog_notify_pretimeout(&_wdt.wdd);
+  return HRTIMER_NORESTART;
+}
+
+static int _wdt_start(struct watchdog_device *wdd) {
+  int64_t res;
+
+  // enable and feed in one masked write
+  res = _i2c_write(I2C_REG_WDT_MAIN, 2, WDT_BIT_ENABLED | WDT_BIT_HEARTBEAT,
+                   WDT_BIT_ENABLED | WDT_BIT_HEARTBEAT);
+  if (res < 0) {
+    return res;
+  }
+  _wdt_pretimer_restart(wdd);
+  return 0;
+}
+
+static int _wdt_stop(struct watchdog_device *wdd) {
+  int64_t res;
+
+  hrtimer_cancel(&_wdt.preTimer);
+  res = _i2c_write(I2C_REG_WDT_MAIN, 2, 0, WDT_BIT_ENABLED);
+  return res < 0 ? res : 0;
+}
+
+static int _wdt_ping(struct watchdog_device *wdd) {
+  int64_t res;
+
+  // write-only, no read-back
+  res = _i2c_write(I2C_REG_WDT_MAIN, 2, WDT_BIT_HEARTBEAT, WDT_BIT_HEARTBEAT);
+  if (res < 0) {
+    return res;
+  }
+  _wdt_pretimer_restart(wdd);
+  return 0;
+}
+
+static int _wdt_set_timeout(struct watchdog_device *wdd, unsigned int t) {
+  int64_t res;
+
+  res = _i2c_write(I2C_REG_WDT_TIMEOUT, 2, t, 0);
+  if (res < 0) {
+    return res;
+  }
+  wdd->timeout = t;
+  if (wdd->pretimeout >= t) {
+    wdd->pretimeout = 0;
+  }
+  if (watchdog_active(wdd)) {
+    _wdt_pretimer_restart(wdd);
+  }
+  return 0;
+}
+
+static int _wdt_set_pretimeout(struct watchdog_device *wdd, unsigned int t) {
+  wdd->pretimeout = t;
+  if (watchdog_active(wdd)) {
+    _wdt_pretimer_restart(wdd);
+  }
+  return 0;
+}
+
+static unsigned int _wdt_get_timeleft(struct watchdog_device *wdd) {
+  s64 elapsed;
+
+  elapsed = ktime_ms_delta(ktime_get(), _wdt.lastPing) / 1000;
+  if (elapsed >= wdd->timeout) {
+    return 0;
+  }
+  return wdd->timeout - elapsed;
+}
+
+static const struct watchdog_info _wdtInfo = {
+    .options = WDIOF_SETTIMEOUT | WDIOF_KEEPALIVEPING | WDIOF_MAGICCLOSE |
+               WDIOF_PRETIMEOUT | WDIOF_CARDRESET,
+    .identity = "Strato Pi Max watchdog",
 };
 
-static struct DeviceAttrBean devAttrBeansLte[] = {
-    {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "enabled",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 0,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 0,
-                .sign = false,
-            },
-    },
+static const struct watchdog_ops _wdtOps = {
+    .owner = THIS_MODULE,
+    .start = _wdt_start,
+    .stop = _wdt_stop,
+    .ping = _wdt_ping,
+    .set_timeout = _wdt_set_timeout,
+    .set_pretimeout = _wdt_set_pretimeout,
+    .get_timeleft = _wdt_get_timeleft,
+};
 
-    {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "rf_enabled",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 0,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 1,
-                .sign = false,
-            },
-    },
+static void _wdt_register(struct platform_device *pdev) {
+  int64_t res;
 
-    {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "gps_enabled",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 0,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 2,
-                .sign = false,
-            },
-    },
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 15, 0)
+  hrtimer_setup(&_wdt.preTimer, _wdt_pretimer_handler, CLOCK_MONOTONIC,
+                HRTIMER_MODE_REL);
+#else
+  hrtimer_init(&_wdt.preTimer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+  _wdt.preTimer.function = &_wdt_pretimer_handler;
+#endif
 
-    {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "reset",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 0,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 3,
-                .sign = false,
-            },
-    },
+  _wdt.wdd.info = &_wdtInfo;
+  _wdt.wdd.ops = &_wdtOps;
+  _wdt.wdd.parent = &pdev->dev;
+  _wdt.wdd.min_timeout = 1;
+  _wdt.wdd.max_timeout = 65535;
+  watchdog_set_nowayout(&_wdt.wdd, WATCHDOG_NOWAYOUT);
 
-    {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "gpio5",
-                        .mode = 0660,
-                    },
-                .show = devAttrI2c_show,
-                .store = devAttrI2c_store,
-            },
-        .regSpecs =
-            {
-                .reg = 0,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 4,
-                .sign = false,
-            },
-    },
+  res = _i2c_read(I2C_REG_WDT_TIMEOUT, 2);
+  _wdt.wdd.timeout = res > 0 ? res : WDT_TIMEOUT_DEFAULT_SEC;
 
-    {
-        .devAttr =
-            {
-                .attr =
-                    {
-                        .name = "gpio6",
-                        .mode = 0440,
-                    },
-                .show = devAttrI2c_show,
-                .store = NULL,
-            },
-        .regSpecs =
-            {
-                .reg = 0,
-                .len = 2,
-                .mask = 0b1,
-                .shift = 5,
-                .sign = false,
-            },
-    },
+  res = _i2c_read(I2C_REG_WDT_MAIN, 2);
+  if (res >= 0) {
+    if (res & WDT_BIT_EXPIRED) {
+      _wdt.wdd.bootstatus = WDIOF_CARDRESET;
+    }
+  }
+  // WDOG_HW_RUNNING is deliberately not set when enabled_config already
+  // enabled it: the heartbeat stays with its current source until
+  // /dev/watchdog is opened
+
+  if (watchdog_register_device(&_wdt.wdd)) {
+    pr_err(LOG_TAG "failed to register watchdog device\n");
+    hrtimer_cancel(&_wdt.preTimer);
+    return;
+  }
+  _wdt.registered = true;
+}
+
+static void _wdt_unregister(void) {
+  if (!_wdt.registered) {
+    return;
+  }
+  watchdog_unregister_device(&_wdt.wdd);
+  hrtimer_cancel(&_wdt.preTimer);
+  _wdt.registered = false;
+}
+
+static void _khb_wq_work(struct work_struct *work) {
+  atomic64_set(&_khb.wqStamp, ktime_get());
+}
+
+static bool _khb_fs_writable(const char *pathName) {
+  struct path path;
+  bool ok;
+
+  if (kern_path(pathName, LOOKUP_FOLLOW, &path)) {
+    return false;
+  }
+  ok = !sb_rdonly(path.dentry->d_sb) &&
+       !(path.mnt->mnt_flags & MNT_READONLY);
+  path_put(&path);
+  return ok;
+}
+
+static uint8_t _khb_check(void) {
+  uint8_t health = 0;
+  ktime_t now, ran;
+  uint32_t t;
+
+  now = ktime_get();
+
+  t = _khb.params[KHB_KEEPALIVE_TIMEOUT];
+  if (t > 0 &&
+      ktime_ms_delta(now, atomic64_read(&_khb.lastKeepalive)) > t * 1000LL) {
+    health |= KHB_FAIL_KEEPALIVE;
+  }
+
+  // work queued on the previous tick: how long it took to run, or how long
+  // it has been waiting
+  t = _khb.params[KHB_WQ_TIMEOUT];
+  ran = atomic64_read(&_khb.wqStamp);
+  if (ktime_before(ran, _khb.wqQueued)) {
+    ran = now;
+  }
+  if (t > 0 && ktime_ms_delta(ran, _khb.wqQueued) > t * 1000LL) {
+    health |= KHB_FAIL_WQ;
+  }
+
+  mutex_lock(&_khb.pathLock);
+  if (_khb.fsPath[0] != '\0' && !_khb_fs_writable(_khb.fsPath)) {
+    health |= KHB_FAIL_FS;
+  }
+  mutex_unlock(&_khb.pathLock);
+
+  return health;
+}
+
+static int _khb_thread(void *arg) {
+  ktime_t next;
+  int64_t res;
+  uint32_t timeout = WDT_TIMEOUT_DEFAULT_SEC;
+  uint32_t period_ms;
+  uint8_t health;
+
+  next = ktime_get();
+  while (!kthread_should_stop()) {
+    res = _i2c_read(I2C_REG_WDT_TIMEOUT, 2);
+    if (res > 0) {
+      timeout = res;
+    }
+
+    health = _khb_check();
+    if (health == 0) {
+      _i2c_write(I2C_REG_WDT_MAIN, 2, WDT_BIT_HEARTBEAT, WDT_BIT_HEARTBEAT);
+    } else if (_khb.health == 0) {
+      pr_notice(LOG_TAG "kernel heartbeat suspended, health=0x%x\n", health);
+    }
+    _khb.health = health;
+    if (!work_pending(&_khb.wqWork)) {
+      _khb.wqQueued = ktime_get();
+      schedule_work(&_khb.wqWork);
+    }
+
+    period_ms = timeout * 10 * _khb.params[KHB_PERIOD];
+    if (period_ms < KHB_PERIOD_MIN_MSEC) {
+      period_ms = KHB_PERIOD_MIN_MSEC;
+    }
+    next = ktime_add_ms(next, period_ms);
+    if (ktime_before(next, ktime_get())) {
+      next = ktime_get();
+    }
+
+    set_current_state(TASK_INTERRUPTIBLE);
+    if (kthread_should_stop()) {
+      __set_current_state(TASK_RUNNING);
+      break;
+    }
+    schedule_hrtimeout(&next, HRTIMER_MODE_ABS);
+  }
+  return 0;
+}
+
+static void _khb_stop(void) {
+  if (_khb.task != NULL) {
+    kthread_stop(_khb.task);
+    _khb.task = NULL;
+    cancel_work_sync(&_khb.wqWork);
+  }
+}
+
+static int _khb_start(void) {
+  struct task_struct *task;
+
+  _khb.wqQueued = ktime_get();
+  atomic64_set(&_khb.lastKeepalive, _khb.wqQueued);
+  atomic64_set(&_khb.wqStamp, _khb.wqQueued);
+  _khb.health = 0;
+
+  task = kthread_run(_khb_thread, NULL, "stratopimax_khb");
+  if (IS_ERR(task)) {
+    return PTR_ERR(task);
+  }
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 9, 0)
+  sched_set_fifo_low(task);
+#endif
+  _khb.task = task;
+  return 0;
+}
+
+static void _khb_init(void) {
+  mutex_init(&_khb.lock);
+  mutex_init(&_khb.pathLock);
+  INIT_WORK(&_khb.wqWork, _khb_wq_work);
+  _khb.params[KHB_PERIOD] = KHB_PERIOD_DEFAULT_PCT;
+  _khb.params[KHB_KEEPALIVE_TIMEOUT] = 0;
+  _khb.params[KHB_WQ_TIMEOUT] = KHB_WQ_TIMEOUT_DEFAULT_SEC;
+}
+
+static ssize_t devAttrKhbEnabled_show(struct device *dev,
+                                      struct device_attribute *attr,
+                                      char *buf) {
+  return sprintf(buf, "%d\n", _khb.task != NULL ? 1 : 0);
+}
+
+static ssize_t devAttrKhbEnabled_store(struct device *dev,
+                                       struct device_attribute *attr,
+                                       const char *buf, size_t count) {
+  bool val;
+  int ret;
+
+  ret = kstrtobool(buf, &val);
+  if (ret < 0) {
+    return ret;
+  }
+
+  mutex_lock(&_khb.lock);
+  if (!val) {
+    _khb_stop();
+  } else if (_khb.task == NULL) {
+    ret = _khb_start();
+  }
+  mutex_unlock(&_khb.lock);
+
+  return ret < 0 ? ret : count;
+}
 
-    {},
-};
+static ssize_t devAttrKhbKeepalive_store(struct device *dev,
+                                         struct device_attribute *attr,
+                                         const char *buf, size_t count) {
+  atomic64_set(&_khb.lastKeepalive, ktime_get());
+  return count;
+}
 
-static uint8_t devUpsExpbTypes[] = {X2_UPS, X2_UPSCAP, 0};
+static ssize_t devAttrKhbParam_show(struct device *dev,
+                                    struct device_attribute *attr, char *buf) {
+  struct DeviceAttrBean *dab;
 
-static uint8_t devUpsBatteryExpbTypes[] = {X2_UPS, 0};
+  dab = container_of(attr, struct DeviceAttrBean, devAttr);
+  if (dab->regSpecs.reg >= KHB_PARAMS_NUM) {
+    return -EFAULT;
+  }
+  return sprintf(buf, "%u\n", _khb.params[dab->regSpecs.reg]);
+}
 
-static uint8_t devDInExpbTypes[] = {X2_D7, 0};
+static ssize_t devAttrKhbParam_store(struct device *dev,
+                                     struct device_attribute *attr,
+                                     const char *buf, size_t count) {
+  struct DeviceAttrBean *dab;
+  unsigned int val;
+  int ret;
 
-static uint8_t devDOutExpbTypes[] = {X2_D7, 0};
+  dab = container_of(attr, struct DeviceAttrBean, devAttr);
+  if (dab->regSpecs.reg >= KHB_PARAMS_NUM) {
+    return -EFAULT;
+  }
+  ret = kstrtouint(buf, 10, &val);
+  if (ret < 0) {
+    return ret;
+  }
 
-static uint8_t devRs485ExpbTypes[] = {X2_232_485, X2_CAN_485, 0};
+  switch (dab->regSpecs.reg) {
+    case KHB_PERIOD:
+      if (val < KHB_PERIOD_MIN_PCT || val > KHB_PERIOD_MAX_PCT) {
+        return -EINVAL;
+      }
+      break;
+    default:
+      if (val > 0xffff) {
+        return -EINVAL;
+      }
+      break;
+  }
 
-static uint8_t devRs422ExpbTypes[] = {X2_422, 0};
+  _khb.params[dab->regSpecs.reg] = val;
+  return count;
+}
 
-static uint8_t devAInExpbTypes[] = {X2_AIN, 0};
+static ssize_t devAttrKhbFsPath_show(struct device *dev,
+                                     struct device_attribute *attr,
+                                     char *buf) {
+  ssize_t ret;
 
-static uint8_t devAOutExpbTypes[] = {X2_AOUT, 0};
+  mutex_lock(&_khb.pathLock);
+  ret = sprintf(buf, "%s\n", _khb.fsPath);
+  mutex_unlock(&_khb.pathLock);
+  return ret;
+}
 
-static uint8_t devLteExpbTypes[] = {X2_GSM, 0};
+static ssize_t devAttrKhbFsPath_store(struct device *dev,
+                                      struct device_attribute *attr,
+                                      const char *buf, size_t count) {
+  size_t len;
 
-static struct DeviceBean devices[] = {
-    {
-        .name = "system",
-        .devAttrBeans = devAttrBeansSystem,
-    },
+  len = strcspn(buf, "\n");
+  if (len >= sizeof(_khb.fsPath)) {
+    return -EINVAL;
+  }
+  if (len > 0 && buf[0] != '/') {
+    return -EINVAL;
+  }
 
-    {
-        .name = "exp_boards",
-        .devAttrBeans = devAttrBeansExpb,
-    },
+  mutex_lock(&_khb.pathLock);
+  memcpy(_khb.fsPath, buf, len);
+  _khb.fsPath[len] = '\0';
+  mutex_unlock(&_khb.pathLock);
+  return count;
+}
 
-    {
-        .name = "power",
-        .devAttrBeans = devAttrBeansPower,
-    },
+static ssize_t devAttrKhbHealth_show(struct device *dev,
+                                     struct device_attribute *attr,
+                                     char *buf) {
+  return sprintf(buf, "%u\n", _khb.health);
+}
 
-    {
-        .name = "watchdog",
-        .devAttrBeans = devAttrBeansWatchdog,
-    },
+static bool _i2c_atomic_supported(void) {
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 2, 0)
+  return rp2_i2c_client != NULL &&
+         rp2_i2c_client->adapter->algo->master_xfer_atomic != NULL;
+#else
+  return false;
+#endif
+}
 
-    {
-        .name = "button",
-        .devAttrBeans = devAttrBeansButton,
-    },
+static int _i2c_write_atomic(uint8_t reg, uint8_t len, uint32_t val,
+                             uint32_t mask) {
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 2, 0)
+  struct i2c_adapter *adap;
+  struct i2c_msg msg;
+  // 1 byte reg + max 4 bytes data + 4 bytes mask + 1 byte crc
+  uint8_t buf[10];
+  uint8_t i;
 
-    {
-        .name = "buzzer",
-        .devAttrBeans = devAttrBeansBuzzer,
-    },
+  if (!_i2c_atomic_supported()) {
+    return -EOPNOTSUPP;
+  }
+  adap = rp2_i2c_client->adapter;
 
-    {
-        .name = "led",
-        .devAttrBeans = devAttrBeansLed,
-    },
+  buf[0] = reg;
+  for (i = 0; i < len; i++) {
+    buf[i + 1] = val >> (8 * i);
+  }
+  if (mask != 0) {
+    for (i = 0; i < len; i++) {
+      buf[i + 1 + len] = mask >> (8 * i);
+    }
+    len *= 2;
+  }
+  _i2c_add_crc(reg, (char *)buf + 1, len);
 
-    {
-        .name = "usb",
-        .devAttrBeans = devAttrBeansUsb,
-    },
+  msg.addr = rp2_i2c_client->addr;
+  msg.flags = 0;
+  msg.len = len + 2;
+  msg.buf = buf;
 
-    {
-        .name = "sd",
-        .devAttrBeans = devAttrBeansSd,
-    },
+  // called with the other CPUs stopped: bypass the bus lock and go straight
+  // to the adapter's polling transfer
+  for (i = 0; i < 10; i++) {
+    if (adap->algo->master_xfer_atomic(adap, &msg, 1) == 1) {
+      return 0;
+    }
+  }
+  return -EIO;
+#else
+  return -EOPNOTSUPP;
+#endif
+}
 
-    {
-        .name = "pcie",
-        .devAttrBeans = devAttrBeansPcie,
-    },
+static int _pwr_reboot_notify(struct notifier_block *nb, unsigned long action,
+                              void *data) {
+  if (action == SYS_POWER_OFF && _pwrNotify.params[PWR_DOWN_ON_POWEROFF]) {
+    if (_i2c_write(I2C_REG_POWER_MAIN, 2, 1, 1) < 0) {
+      pr_err(LOG_TAG "failed to enable power cycle on power off\n");
+    }
+  }
+  return NOTIFY_DONE;
+}
 
-    {
-        .name = "power_in",
-        .devAttrBeans = devAttrBeansPowerIn,
-    },
+static int _pwr_panic_notify(struct notifier_block *nb, unsigned long action,
+                             void *data) {
+  uint16_t timeout;
+  int res = 0;
 
-    {
-        .name = "fan",
-        .devAttrBeans = devAttrBeansFan,
-    },
+  if (_pwrNotify.params[PWR_DOWN_ON_PANIC]) {
+    res = _i2c_write_atomic(I2C_REG_POWER_MAIN, 2, 1, 1);
+  }
 
-    {
-        .name = "accelerometer",
-        .devAttrBeans = devAttrBeansAccel,
-    },
+  timeout = _pwrNotify.params[PWR_PANIC_WDT_TIMEOUT];
+  if (timeout > 0 && res == 0) {
+    res = _i2c_write_atomic(I2C_REG_WDT_TIMEOUT, 2, timeout, 0);
+    if (res == 0) {
+      res = _i2c_write_atomic(I2C_REG_WDT_MAIN, 2,
+                              WDT_BIT_ENABLED | WDT_BIT_HEARTBEAT,
+                              WDT_BIT_ENABLED | WDT_BIT_HEARTBEAT);
+    }
+  }
 
-    {
-        .name = "sec_elem",
-        .devAttrBeans = devAttrBeansAtecc,
-    },
+  if (res == 0 && (_pwrNotify.params[PWR_DOWN_ON_PANIC] || timeout > 0)) {
+    _i2c_write_atomic(I2C_REG_LED_RED_T_ON, 2, PWR_PANIC_BLINK_MSEC, 0);
+    _i2c_write_atomic(I2C_REG_LED_RED_T_OFF, 2, PWR_PANIC_BLINK_MSEC, 0);
+    _i2c_write_atomic(I2C_REG_LED_RED_REPS, 2, 0, 0);
+  }
 
-    {
-        .name = "ups",
-        .devAttrBeans = devAttrBeansUps,
-        .expbTypes = devUpsExpbTypes,
-    },
+  if (res < 0) {
+    pr_emerg(LOG_TAG "panic power cycle failed: %d\n", res);
+  }
+  return NOTIFY_DONE;
+}
 
-    {
-        .name = "ups",
-        .devAttrBeans = devAttrBeansUpsBattery,
-        .expbTypes = devUpsBatteryExpbTypes,
-    },
+static void _pwr_notify_register(void) {
+  _pwrNotify.rebootNb.notifier_call = _pwr_reboot_notify;
+  _pwrNotify.panicNb.notifier_call = _pwr_panic_notify;
+  if (register_reboot_notifier(&_pwrNotify.rebootNb)) {
+    pr_err(LOG_TAG "failed to register reboot notifier\n");
+  } else {
+    _pwrNotify.rebootRegistered = true;
+  }
+  atomic_notifier_chain_register(&panic_notifier_list, &_pwrNotify.panicNb);
+  _pwrNotify.panicRegistered = true;
+  if (!_i2c_atomic_supported()) {
+    // e.g. i2c-bcm2835 on CM4
+    pr_warn(LOG_TAG "no I2C atomic transfers, panic actions disabled\n");
+  }
+}
 
-    {
-        .name = "power_out",
-        .devAttrBeans = devAttrBeansPowerOut,
-        .expbTypes = devUpsBatteryExpbTypes,
-    },
+static void _pwr_notify_unregister(void) {
+  if (_pwrNotify.panicRegistered) {
+    atomic_notifier_chain_unregister(&panic_notifier_list,
+                                     &_pwrNotify.panicNb);
+    _pwrNotify.panicRegistered = false;
+  }
+  if (_pwrNotify.rebootRegistered) {
+    unregister_reboot_notifier(&_pwrNotify.rebootNb);
+    _pwrNotify.rebootRegistered = false;
+  }
+}
 
-    {
-        .name = "digital_in_s%d",
-        .devAttrBeans = devAttrBeansDIn,
-        .expbTypes = devDInExpbTypes,
-    },
+static ssize_t devAttrPwrNotify_show(struct device *dev,
+                                     struct device_attribute *attr,
+                                     char *buf) {
+  struct DeviceAttrBean *dab;
 
-    {
-        .name = "digital_out_s%d",
-        .devAttrBeans = devAttrBeansDOut,
-        .expbTypes = devDOutExpbTypes,
-    },
+  dab = container_of(attr, struct DeviceAttrBean, devAttr);
+  if (dab->regSpecs.reg >= PWR_NOTIFY_PARAMS_NUM) {
+    return -EFAULT;
+  }
+  return sprintf(buf, "%u\n", _pwrNotify.params[dab->regSpecs.reg]);
+}
 
-    {
-        .name = "rs485_s%d",
-        .devAttrBeans = devAttrBeansRs485,
-        .expbTypes = devRs485ExpbTypes,
-    },
+static ssize_t devAttrPwrNotify_store(struct device *dev,
+                                      struct device_attribute *attr,
+                                      const char *buf, size_t count) {
+  struct DeviceAttrBean *dab;
+  unsigned int val;
+  int ret;
 
-    {
-        .name = "rs422_s%d",
-        .devAttrBeans = devAttrBeansRs422,
-        .expbTypes = devRs422ExpbTypes,
-    },
+  dab = container_of(attr, struct DeviceAttrBean, devAttr);
+  if (dab->regSpecs.reg >= PWR_NOTIFY_PARAMS_NUM) {
+    return -EFAULT;
+  }
+  ret = kstrtouint(buf, 10, &val);
+  if (ret < 0) {
+    return ret;
+  }
 
-    {
-        .name = "analog_in_s%d",
-        .devAttrBeans = devAttrBeansAIn,
-        .expbTypes = devAInExpbTypes,
-    },
+  switch (dab->regSpecs.reg) {
+    case PWR_PANIC_WDT_TIMEOUT:
+      if (val > 0xffff) {
+        return -EINVAL;
+      }
+      break;
+    default:
+      if (val > 1) {
+        return -EINVAL;
+      }
+      break;
+  }
 
-    {
-        .name = "analog_out_s%d",
-        .devAttrBeans = devAttrBeansAOut,
-        .expbTypes = devAOutExpbTypes,
-    },
+  _pwrNotify.params[dab->regSpecs.reg] = val;
+  return count;
+}
 
-    {
-        .name = "lte_s%d",
-        .devAttrBeans = devAttrBeansLte,
-        .expbTypes = devLteExpbTypes,
-    },
+static int32_t _accel_angle(const int32_t *a, const int32_t *b) {
+  int64_t dot;
+  uint64_t norm;
+  int32_t cos16;
+  int deg;
+
+  dot = (int64_t)a[0] * b[0] + (int64_t)a[1] * b[1] + (int64_t)a[2] * b[2];
+  norm = (uint64_t)int_sqrt64((int64_t)a[0] * a[0] + (int64_t)a[1] * a[1] +
+                              (int64_t)a[2] * a[2]) *
+         int_sqrt64((int64_t)b[0] * b[0] + (int64_t)b[1] * b[1] +
+                    (int64_t)b[2] * b[2]);
+  if (norm == 0) {
+    return 0;
+  }
+  // cosine scaled by 2^16, compared against the fixed point cosine table
+  cos16 = div64_s64(dot * 65536, norm);
+  for (deg = 0; deg < 180; deg++) {
+    if ((fixp_cos32(deg) >> 15) <= cos16) {
+      break;
+    }
+  }
+  return deg;
+}
 
-    {},
-};
+static void _accel_sample(struct SamplerBean *s) {
+  int64_t vals[3];
+  int32_t a[3];
+  int32_t mag, angle;
+  int64_t sq = 0;
+  char evt[12];
+  int i;
 
-static uint8_t _fwVerMajor;
-static uint8_t _fwVerMinor;
-static struct class *_pDeviceClass;
-static struct ExpbBean _expbs[4];
+  if (_i2c_read_block(I2C_REG_ACCEL_X, 3, 2, vals) < 0) {
+    return;
+  }
+  for (i = 0; i < 3; i++) {
+    a[i] = sign_extend32(vals[i], 15);
+  }
 
-static struct mutex _i2c_mtx;
-static struct i2c_client *rp2_i2c_client = NULL;
-static struct i2c_client *lm75a_i2c_client = NULL;
-static bool _rp2_probed = false;
+  if (_accel.calibrate) {
+    memcpy(_accel.base, a, sizeof(a));
+    _accel.calibrate = false;
+  }
 
-static int64_t _i2cReadVal;
-static uint16_t _i2cReadSize;
+  for (i = 0; i < 3; i++) {
+    sq += (int64_t)(a[i] - _accel.base[i]) * (a[i] - _accel.base[i]);
+  }
+  mag = (int32_t)int_sqrt64(sq) * 1000 / ACCEL_LSB_PER_G;
+  if (mag > _accel.peak) {
+    _accel.peak = mag;
+  }
 
-struct GpioBean *gpioGetBean(struct device *dev, struct device_attribute *attr,
-                             const char **vals) {
-  struct DeviceAttrBean *dab;
-  dab = container_of(attr, struct DeviceAttrBean, devAttr);
-  if (dab == NULL) {
-    return NULL;
+  if (mag >= _accel.params[ACCEL_SHOCK_THRESHOLD]) {
+    if (!_accel.shock) {
+      _accel.shock = true;
+      _accel.shockCount++;
+      snprintf(evt, sizeof(evt), "%u", _accel.shockCount);
+      _event_notify(_accel.device, "shock_count", evt);
+    }
+  } else {
+    _accel.shock = false;
+  }
+
+  angle = _accel_angle(a, _accel.base);
+  _accel.angle = angle;
+  if (!_accel.tilt && angle >= _accel.params[ACCEL_TILT_THRESHOLD]) {
+    _accel.tilt = true;
+    _event_notify(_accel.device, "tilt", "1");
+  } else if (_accel.tilt && angle < _accel.params[ACCEL_TILT_THRESHOLD] -
+                                        ACCEL_TILT_HYST_DEG) {
+    _accel.tilt = false;
+    _event_notify(_accel.device, "tilt", "0");
   }
-  *vals = dab->vals;
-  return dab->gpio;
 }
 
-static bool _i2c_lock(void) {
-  uint8_t i;
-  for (i = 0; i < 20; i++) {
-    if (mutex_trylock(&_i2c_mtx)) {
-      return true;
-    }
-    msleep(1);
+static void _accel_init(void) {
+  mutex_init(&_accel.lock);
+  _sampler_init(&_accel.sampler, ACCEL_INTERVAL_DEFAULT_MSEC, _accel_sample);
+  _accel.params[ACCEL_SHOCK_THRESHOLD] = ACCEL_SHOCK_DEFAULT_MG;
+  _accel.params[ACCEL_TILT_THRESHOLD] = ACCEL_TILT_DEFAULT_DEG;
+}
+
+static ssize_t devAttrAccelDetectEnabled_show(struct device *dev,
+                                              struct device_attribute *attr,
+                                              char *buf) {
+  return sprintf(buf, "%d\n", _accel.sampler.running ? 1 : 0);
+}
+
+static ssize_t devAttrAccelDetectEnabled_store(struct device *dev,
+                                               struct device_attribute *attr,
+                                               const char *buf,
+                                               size_t count) {
+  bool val;
+  int ret;
+
+  ret = kstrtobool(buf, &val);
+  if (ret < 0) {
+    return ret;
   }
-  return false;
+
+  mutex_lock(&_accel.lock);
+  if (val && !_accel.sampler.running) {
+    _accel.device = dev;
+    // baseline from the first sample
+    _accel.calibrate = true;
+    _accel.shock = false;
+    _accel.tilt = false;
+    _sampler_start(&_accel.sampler);
+  } else if (!val) {
+    _sampler_stop(&_accel.sampler);
+  }
+  mutex_unlock(&_accel.lock);
+  return count;
 }
 
-static void _i2c_unlock(void) { mutex_unlock(&_i2c_mtx); }
+static ssize_t devAttrAccelParam_show(struct device *dev,
+                                      struct device_attribute *attr,
+                                      char *buf) {
+  struct DeviceAttrBean *dab;
 
-static uint8_t _i2c_crc_process(uint8_t crc, uint8_t dByte) {
-  uint8_t k;
-  crc ^= dByte;
-  for (k = 0; k < 8; k++) crc = crc & 0x80 ? (crc << 1) ^ 0x2f : crc << 1;
-  return crc;
+  dab = container_of(attr, struct DeviceAttrBean, devAttr);
+  switch (dab->regSpecs.reg) {
+    case ACCEL_SHOCK_THRESHOLD:
+      // fall through
+    case ACCEL_TILT_THRESHOLD:
+      return sprintf(buf, "%d\n", _accel.params[dab->regSpecs.reg]);
+    case ACCEL_INTERVAL:
+      return sprintf(buf, "%u\n", _accel.sampler.interval_ms);
+    case ACCEL_PEAK:
+      return sprintf(buf, "%d\n", _accel.peak);
+    case ACCEL_SHOCK_COUNT:
+      return sprintf(buf, "%u\n", _accel.shockCount);
+    case ACCEL_TILT:
+      return sprintf(buf, "%d\n", _accel.tilt ? 1 : 0);
+    case ACCEL_TILT_ANGLE:
+      if (!_accel.sampler.running) {
+        return -ENODATA;
+      }
+      return sprintf(buf, "%d\n", _accel.angle);
+    default:
+      return -EFAULT;
+  }
 }
 
-static void _i2c_add_crc(int reg, char *data, uint8_t len) {
-  uint8_t i;
-  uint8_t crc;
+static ssize_t devAttrAccelParam_store(struct device *dev,
+                                       struct device_attribute *attr,
+                                       const char *buf, size_t count) {
+  struct DeviceAttrBean *dab;
+  unsigned int val;
+  int ret;
 
-  crc = _i2c_crc_process(0xff, reg);
-  for (i = 0; i < len; i++) {
-    crc = _i2c_crc_process(crc, data[i]);
+  dab = container_of(attr, struct DeviceAttrBean, devAttr);
+  ret = kstrtouint(buf, 10, &val);
+  if (ret < 0) {
+    return ret;
   }
-  data[len] = crc;
+
+  switch (dab->regSpecs.reg) {
+    case ACCEL_SHOCK_THRESHOLD:
+      if (val < 1 || val > ACCEL_SHOCK_MAX_MG) {
+        return -EINVAL;
+      }
+      _accel.params[ACCEL_SHOCK_THRESHOLD] = val;
+      break;
+    case ACCEL_TILT_THRESHOLD:
+      if (val <= ACCEL_TILT_HYST_DEG || val >= 180) {
+        return -EINVAL;
+      }
+      _accel.params[ACCEL_TILT_THRESHOLD] = val;
+      break;
+    case ACCEL_INTERVAL:
+      if (val < ACCEL_INTERVAL_MIN_MSEC) {
+        return -EINVAL;
+      }
+      _sampler_set_interval(&_accel.sampler, val);
+      break;
+    case ACCEL_PEAK:
+      _accel.peak = 0;
+      break;
+    case ACCEL_CALIBRATE:
+      _accel.calibrate = true;
+      break;
+    default:
+      return -EFAULT;
+  }
+  return count;
 }
 
-static int64_t _i2c_read_no_lock(uint8_t reg, uint8_t len) {
+static void _button_key(uint8_t key, int value) {
+  input_report_key(_button.input, _button.keymap[key], value);
+  input_sync(_button.input);
+}
+
+static void _button_sample(struct SamplerBean *s) {
   int64_t res;
-  char buf[5];  // max 4 bytes data + 1 byte crc
-  uint8_t i;
-  uint8_t crc;
-#if DEBUG_I2C
-  uint8_t j;
-#endif
+  bool pressed, down;
+  uint8_t count, delta, quick;
 
-  if (rp2_i2c_client == NULL) {
-    return -ENODEV;
+  res = _i2c_read(I2C_REG_BUTTON, 2);
+  if (res < 0) {
+    return;
   }
+  pressed = (res & 1) == 1;
+  count = (res >> 8) & 0xff;
 
-  for (i = 0; i < 10; i++) {
-    res = i2c_smbus_read_i2c_block_data(rp2_i2c_client, reg, len + 1, buf);
-    if (res == len + 1) {
-      crc = buf[len];
-      _i2c_add_crc(reg, buf, len);
-      if (crc == buf[len]) {
-        break;
-      } else {
-#if DEBUG_I2C
-        pr_notice(LOG_TAG "i2c read error: reg=%d\n", reg);
-        for (j = 0; j < len; j++) {
-          pr_notice(LOG_TAG "data[%d]=0x%x\n", j, buf[j]);
-        }
-        pr_notice(LOG_TAG "crc=0x%x crc_rcv=0x%x\n", buf[len], crc);
-#endif
-        res = -1;
-      }
-    }
+  if (!_button.valid) {
+    _button.count = count;
+    _button.valid = true;
   }
+  delta = count - _button.count;
+  _button.count = count;
 
-  if (res != len + 1) {
-#if DEBUG_I2C
-    pr_notice(LOG_TAG "i2c read error: %lld\n", res);
-#endif
-    return -EIO;
+  // the firmware counter catches presses shorter than the poll interval
+  down = pressed && (!_button.pressed || delta > 0);
+  if (_button.pressed && (!pressed || delta > 0)) {
+    _button_key(BUTTON_KEY_PRESS, 0);
   }
-
-  res = 0;
-  for (i = 0; i < len; i++) {
-    res |= (buf[i] & ((int64_t)0xff)) << (i * 8);
+  // presses started and ended between two samples
+  quick = (down && delta > 0) ? delta - 1 : delta;
+  if (quick > BUTTON_MISSED_MAX) {
+    quick = BUTTON_MISSED_MAX;
+  }
+  while (quick-- > 0) {
+    _button_key(BUTTON_KEY_PRESS, 1);
+    _button_key(BUTTON_KEY_PRESS, 0);
+  }
+  if (down) {
+    _button_key(BUTTON_KEY_PRESS, 1);
+    _button.pressedSince = ktime_get();
+    _button.longSent = false;
   }
+  _button.pressed = pressed;
+
+  if (pressed && !_button.longSent && _button.longPress_ms > 0 &&
+      ktime_ms_delta(ktime_get(), _button.pressedSince) >=
+          _button.longPress_ms) {
+    _button_key(BUTTON_KEY_LONG_PRESS, 1);
+    _button_key(BUTTON_KEY_LONG_PRESS, 0);
+    _button.longSent = true;
+  }
+}
 
-  return res;
+static void _button_init(void) {
+  _sampler_init(&_button.sampler, BUTTON_INTERVAL_DEFAULT_MSEC, _button_sample);
+  _button.longPress_ms = BUTTON_LONG_PRESS_DEFAULT_MSEC;
+  _button.keymap[BUTTON_KEY_PRESS] = KEY_PROG1;
+  _button.keymap[BUTTON_KEY_LONG_PRESS] = KEY_PROG2;
 }
 
-static int64_t _i2c_write_no_lock(uint8_t reg, uint8_t len, uint32_t val,
-                                  uint32_t mask) {
-  char buf[9];  // max 4 bytes data + 4 bytes mask + 1 byte crc
-  uint8_t i;
+static int _button_open(struct input_dev *input) {
+  // sample only while someone listens; the press counter is resynced on
+  // the first sample
+  _button.valid = false;
+  _button.pressed = false;
+  _sampler_start(&_button.sampler);
+  return 0;
+}
 
-  if (rp2_i2c_client == NULL) {
-    return -ENODEV;
-  }
+static void _button_close(struct input_dev *input) {
+  _sampler_stop(&_button.sampler);
+}
 
-  for (i = 0; i < len; i++) {
-    buf[i] = val >> (8 * i);
+static void _button_register(struct platform_device *pdev) {
+  struct input_dev *input;
+  int i;
+
+  input = input_allocate_device();
+  if (input == NULL) {
+    pr_err(LOG_TAG "failed to allocate input device\n");
+    return;
   }
-  if (mask != 0) {
-    for (i = 0; i < len; i++) {
-      buf[i + len] = mask >> (8 * i);
-    }
-    len *= 2;
+  input->name = "Strato Pi Max button";
+  input->phys = "stratopimax/input0";
+  input->id.bustype = BUS_HOST;
+  input->dev.parent = &pdev->dev;
+  input->open = _button_open;
+  input->close = _button_close;
+  // remappable with EVIOCSKEYCODE (e.g. udev hwdb)
+  input->keycode = _button.keymap;
+  input->keycodesize = sizeof(_button.keymap[0]);
+  input->keycodemax = ARRAY_SIZE(_button.keymap);
+  __set_bit(EV_KEY, input->evbit);
+  for (i = 0; i < ARRAY_SIZE(_button.keymap); i++) {
+    __set_bit(_button.keymap[i], input->keybit);
   }
-  _i2c_add_crc(reg, buf, len);
-  len++;
 
-  for (i = 0; i < 10; i++) {
-    if (!i2c_smbus_write_i2c_block_data(rp2_i2c_client, reg, len, buf)) {
-      return len;
-    }
+  if (input_register_device(input)) {
+    pr_err(LOG_TAG "failed to register input device\n");
+    input_free_device(input);
+    return;
   }
-  return -EIO;
+  _button.input = input;
 }
 
-static int64_t _i2c_read(uint8_t reg, uint8_t len) {
-  int64_t res;
-
-  if (len == 0) {
-    return -EINVAL;
+static void _button_unregister(void) {
+  _sampler_stop(&_button.sampler);
+  if (_button.input != NULL) {
+    input_unregister_device(_button.input);
+    _button.input = NULL;
   }
+}
 
-  if (!_i2c_lock()) {
-    return -EBUSY;
+static ssize_t devAttrButtonInput_show(struct device *dev,
+                                       struct device_attribute *attr,
+                                       char *buf) {
+  struct DeviceAttrBean *dab;
+
+  dab = container_of(attr, struct DeviceAttrBean, devAttr);
+  if (dab->regSpecs.reg == BUTTON_PARAM_INTERVAL) {
+    return sprintf(buf, "%u\n", _button.sampler.interval_ms);
   }
+  return sprintf(buf, "%u\n", _button.longPress_ms);
+}
 
-  res = _i2c_read_no_lock(reg, len);
+static ssize_t devAttrButtonInput_store(struct device *dev,
+                                        struct device_attribute *attr,
+                                        const char *buf, size_t count) {
+  struct DeviceAttrBean *dab;
+  unsigned int val;
+  int ret;
 
-  _i2c_unlock();
+  dab = container_of(attr, struct DeviceAttrBean, devAttr);
+  ret = kstrtouint(buf, 10, &val);
+  if (ret < 0) {
+    return ret;
+  }
 
-  return res;
+  if (dab->regSpecs.reg == BUTTON_PARAM_INTERVAL) {
+    if (val < BUTTON_INTERVAL_MIN_MSEC) {
+      return -EINVAL;
+    }
+    _sampler_set_interval(&_button.sampler, val);
+  } else {
+    _button.longPress_ms = val;
+  }
+  return count;
 }
 
-static int64_t _i2c_write(uint8_t reg, uint8_t len, uint32_t val,
-                          uint32_t mask) {
+static int _led_write(struct LedBean *l, uint16_t on, uint16_t off) {
   int64_t res;
 
-  if (!_i2c_lock()) {
-    return -EBUSY;
+  res = _i2c_write(l->reg, 2, on, 0);
+  if (res >= 0) {
+    res = _i2c_write(l->reg + 1, 2, off, 0);
+  }
+  if (res >= 0) {
+    // continuous
+    res = _i2c_write(l->reg + 2, 2, 0, 0);
   }
+  return res < 0 ? res : 0;
+}
 
-  res = _i2c_write_no_lock(reg, len, val, mask);
+static void _led_blink_work(struct work_struct *work) {
+  struct LedBean *l;
 
-  _i2c_unlock();
+  l = container_of(work, struct LedBean, work);
+  if (_led_write(l, l->blinkOn, l->blinkOff)) {
+    pr_err(LOG_TAG "failed to set %s blink\n", l->cdev.name);
+  }
+}
 
-  return res;
+static int _led_brightness_set(struct led_classdev *cdev,
+                               enum led_brightness brightness) {
+  struct LedBean *l;
+
+  l = container_of(cdev, struct LedBean, cdev);
+  cancel_work_sync(&l->work);
+  // T_ON = 1 with T_OFF = 0 is steady on
+  return _led_write(l, brightness ? 1 : 0, 0);
 }
 
-static int64_t _i2c_read_segment(uint8_t reg, uint8_t len, uint32_t mask,
-                                 uint8_t shift) {
-  int64_t res;
-  res = _i2c_read(reg, len);
-  if (res < 0) {
-    return res;
+static int _led_blink_set(struct led_classdev *cdev, unsigned long *delay_on,
+                          unsigned long *delay_off) {
+  struct LedBean *l;
+
+  l = container_of(cdev, struct LedBean, cdev);
+  if (*delay_on == 0 && *delay_off == 0) {
+    *delay_on = LED_BLINK_DEFAULT_MSEC;
+    *delay_off = LED_BLINK_DEFAULT_MSEC;
   }
-  res >>= shift;
-  if (mask != 0) {
-    res &= mask;
+  if (*delay_on == 0 || *delay_off == 0 || *delay_on > 0xffff ||
+      *delay_off > 0xffff) {
+    // not representable, let the core blink in software
+    return -EINVAL;
   }
-  return res;
+  l->blinkOn = *delay_on;
+  l->blinkOff = *delay_off;
+  // may be called in atomic context, the RP2 is programmed from a work
+  schedule_work(&l->work);
+  return 0;
 }
 
-static int64_t _i2c_write_segment(uint8_t reg, uint8_t len, uint32_t mask,
-                                  uint8_t shift, uint32_t val, bool readBack) {
-  int64_t res = 0;
-  uint8_t i, j, b;
-  bool ok;
-
-  if (!_i2c_lock()) {
-    return -EBUSY;
+static void _led_register(struct platform_device *pdev) {
+  struct LedBean *l;
+  int i;
+
+  for (i = 0; i < ARRAY_SIZE(_leds); i++) {
+    l = &_leds[i];
+    INIT_WORK(&l->work, _led_blink_work);
+    l->cdev.max_brightness = 1;
+    l->cdev.brightness_set_blocking = _led_brightness_set;
+    l->cdev.blink_set = _led_blink_set;
+    if (led_classdev_register(&pdev->dev, &l->cdev)) {
+      pr_err(LOG_TAG "failed to register LED %s\n", l->cdev.name);
+      continue;
+    }
+    l->registered = true;
   }
+}
 
-  val <<= shift;
-
-  if (mask != 0) {
-    mask <<= shift;
-    val &= mask;
-  }
+static void _led_unregister(void) {
+  struct LedBean *l;
+  int i;
 
-  for (i = 0; i < 5; i++) {
-    res = _i2c_write_no_lock(reg, len, val, mask);
-    if (res >= 0) {
-      if (readBack) {
-        for (j = 0; j < 2; j++) {
-          res = _i2c_read_no_lock(reg, len);
-          if (res >= 0) {
-            if (mask != 0) {
-              res &= mask;
-            }
-            ok = true;
-            for (b = 0; b < len; b++) {
-              if (((val >> (b * 8)) & 0xff) != ((res >> (b * 8)) & 0xff)) {
-                ok = false;
-                break;
-              }
-            }
-            if (ok) {
-              res = len;
-              break;
-            }
-            res = -EPERM;
-          }
-#if DEBUG_I2C
-            pr_notice(LOG_TAG "i2c write error: reg=%d len=%d w=0x%x r=0x%x\n",
-                      reg, len, val, (uint32_t)res);
-#endif
-        }
-        if (res >= 0) {
-          break;
-        }
-      } else {
-        break;
-      }
+  for (i = 0; i < ARRAY_SIZE(_leds); i++) {
+    l = &_leds[i];
+    if (l->registered) {
+      led_classdev_unregister(&l->cdev);
+      cancel_work_sync(&l->work);
+      l->registered = false;
     }
   }
+}
 
-  _i2c_unlock();
+static bool _gpiochip_lte_line(unsigned int offset, uint8_t *reg,
+                               uint8_t *shift) {
+  uint8_t idx;
 
-  return res;
+  if (offset < GPIOCHIP_LINE_LTE_START) {
+    return false;
+  }
+  idx = (offset - GPIOCHIP_LINE_LTE_START) / 2;
+  *reg = I2C_EXPB_IDX_TO_REG_START(idx);
+  // same bits as lte_s<n>/gpio5 and gpio6
+  *shift = 4 + (offset - GPIOCHIP_LINE_LTE_START) % 2;
+  return true;
 }
 
-static ssize_t devAttrI2c_show(struct device *dev,
-                               struct device_attribute *attr, char *buf) {
-  struct DeviceAttrRegSpecs *specs;
-  struct DeviceAttrBean *dab;
-  struct DeviceData *data;
-  uint8_t reg;
-  int64_t res;
+static int _gpiochip_request(struct gpio_chip *gc, unsigned int offset) {
+  struct gpio_desc *desc;
 
-  data = dev_get_drvdata(dev);
-  dab = container_of(attr, struct DeviceAttrBean, devAttr);
-  if (dab == NULL) {
-    return -EFAULT;
+  if (offset >= GPIOCHIP_EXP_LINES_NUM) {
+    return 0;
   }
-  specs = &dab->regSpecs;
-  if (specs->len == 0) {
-    return -EFAULT;
+  // the SoC line is only taken while requested here, -EBUSY if in use
+  mutex_lock(&_gpioChip.lock);
+  desc = gpiod_get(gc->parent, _gpioChip.expConIds[offset], GPIOD_ASIS);
+  if (IS_ERR(desc)) {
+    mutex_unlock(&_gpioChip.lock);
+    return PTR_ERR(desc);
   }
+  _gpioChip.exp[offset] = desc;
+  mutex_unlock(&_gpioChip.lock);
+  return 0;
+}
 
-  reg = specs->reg;
-  if (data != NULL) {
-    reg += I2C_EXPB_IDX_TO_REG_START(data->expbIdx);
+static void _gpiochip_free(struct gpio_chip *gc, unsigned int offset) {
+  if (offset >= GPIOCHIP_EXP_LINES_NUM) {
+    return;
+  }
+  mutex_lock(&_gpioChip.lock);
+  if (_gpioChip.exp[offset] != NULL) {
+    gpiod_put(_gpioChip.exp[offset]);
+    _gpioChip.exp[offset] = NULL;
   }
+  mutex_unlock(&_gpioChip.lock);
+}
 
-  res = _i2c_read_segment(reg, specs->len, specs->mask, specs->shift);
+static int _gpiochip_get_direction(struct gpio_chip *gc, unsigned int offset) {
+  uint8_t reg, shift;
 
-  if (res < 0) {
-    return res;
+  if (offset < GPIOCHIP_EXP_LINES_NUM) {
+    if (_gpioChip.exp[offset] == NULL) {
+      return GPIO_LINE_DIRECTION_IN;
+    }
+    return gpiod_get_direction(_gpioChip.exp[offset]);
+  }
+  if (_gpiochip_lte_line(offset, &reg, &shift) && shift == 4) {
+    return GPIO_LINE_DIRECTION_OUT;
   }
+  return GPIO_LINE_DIRECTION_IN;
+}
 
-  return valToStr(buf, res, dab->vals, specs->sign, specs->len, specs->base,
-                  specs->mask);
+static int _gpiochip_direction_input(struct gpio_chip *gc,
+                                     unsigned int offset) {
+  uint8_t reg, shift;
+
+  if (offset < GPIOCHIP_EXP_LINES_NUM) {
+    return gpiod_direction_input(_gpioChip.exp[offset]);
+  }
+  if (_gpiochip_lte_line(offset, &reg, &shift) && shift == 4) {
+    return -EPERM;
+  }
+  return 0;
 }
 
-static ssize_t devAttrI2c_show_clear(struct device *dev,
-                                     struct device_attribute *attr, char *buf) {
-  ssize_t res = devAttrI2c_show(dev, attr, buf);
-  if (res >= 0) {
-    devAttrI2c_store(dev, attr, "0", 1);
+static int _gpiochip_get(struct gpio_chip *gc, unsigned int offset) {
+  uint8_t reg, shift;
+
+  if (offset < GPIOCHIP_EXP_LINES_NUM) {
+    return gpiod_get_value_cansleep(_gpioChip.exp[offset]);
   }
-  return res;
+  if (offset == GPIOCHIP_LINE_SD_ROUTE) {
+    return gpiod_get_value_cansleep(gpioSdRoute.desc);
+  }
+  _gpiochip_lte_line(offset, &reg, &shift);
+  return _i2c_read_segment(reg, 2, 0b1, shift);
 }
 
-static ssize_t devAttrI2c_store(struct device *dev,
-                                struct device_attribute *attr, const char *buf,
-                                size_t count) {
-  struct DeviceAttrRegSpecs *specs;
-  struct DeviceAttrBean *dab;
-  struct DeviceData *data;
-  uint8_t reg;
-  int64_t res;
+static unsigned int _gpiochip_exp_subset(unsigned long *mask,
+                                         struct gpio_desc **descs,
+                                         unsigned int *lines) {
+  unsigned int offset, n = 0;
 
-  data = dev_get_drvdata(dev);
-  dab = container_of(attr, struct DeviceAttrBean, devAttr);
-  if (dab == NULL) {
-    return -EFAULT;
+  for_each_set_bit(offset, mask, GPIOCHIP_EXP_LINES_NUM) {
+    lines[n] = offset;
+    descs[n++] = _gpioChip.exp[offset];
   }
-  specs = &dab->regSpecsStore;
-  if (specs->len == 0) {
-    specs = &dab->regSpecs;
-    if (specs->len == 0) {
-      return -EFAULT;
+  return n;
+}
+
+static int _gpiochip_get_multiple(struct gpio_chip *gc, unsigned long *mask,
+                                  unsigned long *bits) {
+  struct gpio_desc *descs[GPIOCHIP_EXP_LINES_NUM];
+  unsigned int lines[GPIOCHIP_EXP_LINES_NUM];
+  unsigned long vals = 0;
+  unsigned int offset, i, n;
+  uint8_t reg, shift;
+  int64_t res;
+  int val;
+
+  // slot lines are read with a single access to the SoC GPIO controller
+  n = _gpiochip_exp_subset(mask, descs, lines);
+  if (n > 0) {
+    val = gpiod_get_array_value_cansleep(n, descs, NULL, &vals);
+    if (val < 0) {
+      return val;
+    }
+    for (i = 0; i < n; i++) {
+      __assign_bit(lines[i], bits, test_bit(i, &vals));
     }
   }
 
-  res = strToVal(buf, dab->vals, specs->sign, specs->base);
-  if (res < 0) {
-    return res;
+  if (test_bit(GPIOCHIP_LINE_SD_ROUTE, mask)) {
+    val = _gpiochip_get(gc, GPIOCHIP_LINE_SD_ROUTE);
+    if (val < 0) {
+      return val;
+    }
+    __assign_bit(GPIOCHIP_LINE_SD_ROUTE, bits, val);
   }
 
-  reg = specs->reg;
-  if (data != NULL) {
-    reg += I2C_EXPB_IDX_TO_REG_START(data->expbIdx);
+  // gpio5 and gpio6 of a slot share the register, read it once
+  for (offset = GPIOCHIP_LINE_LTE_START; offset < GPIOCHIP_LINES_NUM;
+       offset += 2) {
+    if (!test_bit(offset, mask) && !test_bit(offset + 1, mask)) {
+      continue;
+    }
+    _gpiochip_lte_line(offset, &reg, &shift);
+    res = _i2c_read(reg, 2);
+    if (res < 0) {
+      return res;
+    }
+    __assign_bit(offset, bits, (res >> shift) & 0b1);
+    __assign_bit(offset + 1, bits, (res >> (shift + 1)) & 0b1);
   }
+  return 0;
+}
 
-  res = _i2c_write_segment(reg, specs->len, specs->mask, specs->shift,
-                           (uint32_t)res,
-                           attr->store != NULL && attr->show != NULL);
+static int _gpiochip_set_val(unsigned int offset, int value) {
+  uint8_t reg, shift;
+  int64_t res;
 
-  if (res < 0) {
-    return res;
+  if (offset < GPIOCHIP_EXP_LINES_NUM) {
+    gpiod_set_value_cansleep(_gpioChip.exp[offset], value);
+    return 0;
   }
-
-  return count;
+  if (!_gpiochip_lte_line(offset, &reg, &shift) || shift != 4) {
+    return -EPERM;
+  }
+  res = _i2c_write_segment(reg, 2, 0b1, shift, value ? 1 : 0, false);
+  return res < 0 ? res : 0;
 }
 
-static ssize_t getFwVersion(void) {
-  int64_t val;
-  val = _i2c_read(1, 2);
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 17, 0)
+static int _gpiochip_set(struct gpio_chip *gc, unsigned int offset,
+                         int value) {
+  return _gpiochip_set_val(offset, value);
+}
+#else
+static void _gpiochip_set(struct gpio_chip *gc, unsigned int offset,
+                          int value) {
+  _gpiochip_set_val(offset, value);
+}
+#endif
 
-  if (val < 0) {
-    return val;
+static int _gpiochip_set_multiple_val(unsigned long *mask,
+                                      unsigned long *bits) {
+  struct gpio_desc *descs[GPIOCHIP_EXP_LINES_NUM];
+  unsigned int lines[GPIOCHIP_EXP_LINES_NUM];
+  unsigned long vals = 0;
+  unsigned int offset, i, n;
+  int res;
+
+  n = _gpiochip_exp_subset(mask, descs, lines);
+  if (n > 0) {
+    for (i = 0; i < n; i++) {
+      __assign_bit(i, &vals, test_bit(lines[i], bits));
+    }
+    res = gpiod_set_array_value_cansleep(n, descs, NULL, &vals);
+    if (res < 0) {
+      return res;
+    }
   }
 
-  _fwVerMajor = (val >> 8) & 0xff;
-  _fwVerMinor = val & 0xff;
-
+  for_each_set_bit(offset, mask, GPIOCHIP_LINES_NUM) {
+    if (offset < GPIOCHIP_EXP_LINES_NUM) {
+      continue;
+    }
+    res = _gpiochip_set_val(offset, test_bit(offset, bits));
+    if (res < 0) {
+      return res;
+    }
+  }
   return 0;
 }
 
-static ssize_t devAttrFwVersion_show(struct device *dev,
-                                     struct device_attribute *attr, char *buf) {
-  int32_t res;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 17, 0)
+static int _gpiochip_set_multiple(struct gpio_chip *gc, unsigned long *mask,
+                                  unsigned long *bits) {
+  return _gpiochip_set_multiple_val(mask, bits);
+}
+#else
+static void _gpiochip_set_multiple(struct gpio_chip *gc, unsigned long *mask,
+                                   unsigned long *bits) {
+  _gpiochip_set_multiple_val(mask, bits);
+}
+#endif
 
-  res = getFwVersion();
-  if (res < 0) {
-    return res;
+static int _gpiochip_direction_output(struct gpio_chip *gc,
+                                      unsigned int offset, int value) {
+  if (offset < GPIOCHIP_EXP_LINES_NUM) {
+    return gpiod_direction_output(_gpioChip.exp[offset], value);
   }
+  return _gpiochip_set_val(offset, value);
+}
 
-  return sprintf(buf, "%d.%d\n", _fwVerMajor, _fwVerMinor);
+static int _gpiochip_to_irq(struct gpio_chip *gc, unsigned int offset) {
+  if (offset < GPIOCHIP_EXP_LINES_NUM) {
+    if (_gpioChip.exp[offset] == NULL) {
+      return -ENXIO;
+    }
+    return gpiod_to_irq(_gpioChip.exp[offset]);
+  }
+  if (offset == GPIOCHIP_LINE_SD_ROUTE) {
+    return gpiod_to_irq(gpioSdRoute.desc);
+  }
+  return -ENXIO;
 }
 
-static ssize_t devAttrConfig_store(struct device *dev,
-                                   struct device_attribute *attr,
-                                   const char *buf, size_t count) {
-  int64_t res;
-  uint32_t val;
-  uint16_t i;
-  char cmd;
-  cmd = toUpper(buf[0]);
-  if (cmd == 'R') {
-    val = 0x02;
-  } else {
-    val = cmd;
+static int _gpiochip_init_valid_mask(struct gpio_chip *gc,
+                                     unsigned long *valid_mask,
+                                     unsigned int ngpios) {
+  unsigned int offset;
+
+  for (offset = 0; offset < GPIOCHIP_EXP_LINES_NUM; offset++) {
+    if (gpiod_count(gc->parent, _gpioChip.expConIds[offset]) <= 0) {
+      clear_bit(offset, valid_mask);
+    }
+  }
+  for (offset = GPIOCHIP_LINE_LTE_START; offset < ngpios; offset++) {
+    if (_expbs[(offset - GPIOCHIP_LINE_LTE_START) / 2].type != X2_GSM) {
+      clear_bit(offset, valid_mask);
+    }
   }
+  return 0;
+}
 
-  if (!_i2c_lock()) {
-    return -EBUSY;
+static void _gpiochip_init(void) {
+  int i;
+
+  mutex_init(&_gpioChip.lock);
+  // the slot lines are not taken here: a line is taken from the SoC when
+  // requested on this chip, or when its capture is enabled
+  for (i = 0; i < GPIOCHIP_EXP_LINES_NUM; i++) {
+    snprintf(_gpioChip.expConIds[i], sizeof(_gpioChip.expConIds[i]),
+             "stratopimax_%s", _gpioChipNames[i]);
+    _expCaptures[i].gpio.name = _gpioChip.expConIds[i];
+    _expCaptures[i].gpio.desc = NULL;
+    gpioSetupCapture(&_expCaptures[i]);
   }
+}
 
-  res = _i2c_write_no_lock(I2C_REG_USER_CFG_CMD, 2, 0x2a00 | val, 0);
-  if (res > 0) {
-    for (i = 0; i < 10; i++) {
-      msleep(1);
-      res = _i2c_read_no_lock(I2C_REG_USER_CFG_STATE, 2);
-      if (res > 0) {
-        if ((res & 0xff) != val) {
-          res = -EBUSY;
-          break;
-        }
-        if (((res >> 10) & 1) == 0) {
-          if (((res >> 8) & 1) == 1) {
-            res = count;
-          } else if (((res >> 11) & 1) == 1) {
-            res = -EINVAL;
-          } else {
-            res = -EFAULT;
-          }
-          break;
-        } else {
-          res = -EBUSY;
-        }
-      }
-    }
+static void _gpiochip_register(struct platform_device *pdev) {
+  struct gpio_chip *gc = &_gpioChip.chip;
+
+  gc->label = "stratopimax";
+  gc->parent = &pdev->dev;
+  gc->owner = THIS_MODULE;
+  gc->base = -1;
+  gc->ngpio = GPIOCHIP_LINES_NUM;
+  gc->names = _gpioChipNames;
+  gc->can_sleep = true;
+  gc->init_valid_mask = _gpiochip_init_valid_mask;
+  gc->request = _gpiochip_request;
+  gc->free = _gpiochip_free;
+  gc->get_direction = _gpiochip_get_direction;
+  gc->direction_input = _gpiochip_direction_input;
+  gc->direction_output = _gpiochip_direction_output;
+  gc->get = _gpiochip_get;
+  gc->get_multiple = _gpiochip_get_multiple;
+  gc->set = _gpiochip_set;
+  gc->set_multiple = _gpiochip_set_multiple;
+  gc->to_irq = _gpiochip_to_irq;
+
+  if (gpiochip_add_data(gc, &_gpioChip)) {
+    pr_err(LOG_TAG "failed to register gpiochip\n");
+    return;
   }
+  _gpioChip.registered = true;
+}
 
-  _i2c_unlock();
+static void _gpiochip_unregister(void) {
+  int i;
 
-  return res;
+  for (i = 0; i < GPIOCHIP_EXP_LINES_NUM; i++) {
+    gpioFreeCapture(&_expCaptures[i]);
+  }
+  if (_gpioChip.registered) {
+    gpiochip_remove(&_gpioChip.chip);
+    _gpioChip.registered = false;
+  }
+  // lines still requested when the chip goes away
+  for (i = 0; i < GPIOCHIP_EXP_LINES_NUM; i++) {
+    _gpiochip_free(&_gpioChip.chip, i);
+  }
 }
 
-static ssize_t devAttrI2cRead_show(struct device *dev,
-                                   struct device_attribute *attr, char *buf) {
-  if (_i2cReadSize == 1) {
-    return sprintf(buf, "0x%02x\n", (uint32_t)_i2cReadVal);
-  } else if (_i2cReadSize == 2) {
-    return sprintf(buf, "0x%04x\n", (uint32_t)_i2cReadVal);
-  } else if (_i2cReadSize == 3) {
-    return sprintf(buf, "0x%06x\n", (uint32_t)_i2cReadVal);
-  } else {
-    return sprintf(buf, "0x%08x\n", (uint32_t)_i2cReadVal);
+static struct device *_expb_device(int8_t expbIdx, const char *name) {
+  struct DeviceData *data;
+
+  if (expbIdx < 0) {
+    return NULL;
+  }
+  data = _expbs[expbIdx].data;
+  while (data != NULL) {
+    if (data->device != NULL && strcmp(dev_name(data->device), name) == 0) {
+      return data->device;
+    }
+    data = data->next;
   }
+  return NULL;
 }
 
-static ssize_t devAttrI2cRead_store(struct device *dev,
-                                    struct device_attribute *attr,
-                                    const char *buf, size_t count) {
-  unsigned long reg;
-  char *end = NULL;
+static void _ups_coulomb_update(void) {
+  ktime_t now;
+  int64_t dt_msec = 0;
+  int64_t full;
 
-  reg = simple_strtoul(buf, &end, 10);
-  if (++end < buf + count) {
-    _i2cReadSize = simple_strtoul(end, NULL, 10);
-  } else {
-    _i2cReadSize = 2;
+  now = ktime_get();
+  if (_ups.ccLastValid) {
+    dt_msec = ktime_ms_delta(now, _ups.ccLast);
   }
+  _ups.ccLast = now;
+  _ups.ccLastValid = true;
 
-  if (reg > 255 || _i2cReadSize > 4) {
-    return -EINVAL;
+  full = (int64_t)_ups.capacity * 3600000;
+
+  switch (_ups.status) {
+    case UPS_STATUS_CHARGED:
+      // recalibrate
+      _ups.charge = full;
+      _ups.chargeValid = true;
+      break;
+    case UPS_STATUS_CHARGING:
+      _ups.charge += (int64_t)_ups.chargerI * dt_msec;
+      break;
+    case UPS_STATUS_BACKUP:
+      // fall through
+    case UPS_STATUS_BACKUP_LOW:
+      _ups.charge -= (int64_t)_ups.chargerI * dt_msec;
+      break;
+    default:
+      break;
   }
 
-  _i2cReadVal = _i2c_read(reg, _i2cReadSize);
+  if (_ups.charge > full) {
+    _ups.charge = full;
+  } else if (_ups.charge < 0) {
+    _ups.charge = 0;
+  }
 
-  if (_i2cReadVal < 0) {
-    return _i2cReadVal;
+  if (_ups.status == UPS_STATUS_BACKUP ||
+      _ups.status == UPS_STATUS_BACKUP_LOW) {
+    if (_ups.dischargeI == 0) {
+      _ups.dischargeI = _ups.chargerI;
+    } else {
+      _ups.dischargeI = (_ups.dischargeI * 7 + _ups.chargerI) / 8;
+    }
+  } else {
+    _ups.dischargeI = 0;
   }
+}
 
-  return count;
+static int _ups_soc(int *val) {
+  if (_ups.type != X2_UPS || !_ups.chargeValid || _ups.capacity <= 0) {
+    return -ENODATA;
+  }
+  *val = div64_s64(_ups.charge * 100, (int64_t)_ups.capacity * 3600000);
+  return 0;
 }
 
-static ssize_t devAttrI2cWrite_store(struct device *dev,
-                                     struct device_attribute *attr,
-                                     const char *buf, size_t count) {
-  unsigned long reg;
-  unsigned long val = 0;
-  size_t size;
-  char *start = NULL;
-  char *end = NULL;
+static int _ups_time_to_empty(int *val) {
+  if (_ups.type != X2_UPS || !_ups.chargeValid || _ups.dischargeI <= 0) {
+    return -ENODATA;
+  }
+  // mA * ms / mA => ms => s
+  *val = div64_s64(_ups.charge, _ups.dischargeI) / 1000;
+  return 0;
+}
 
-  reg = simple_strtoul(buf, &end, 10);
+static void _ups_shutdown_set_state(uint8_t state) {
+  char val[4];
 
-  if (++end >= buf + count) {
-    return -EINVAL;
+  _ups.sdState = state;
+  if (_ups.device != NULL) {
+    snprintf(val, sizeof(val), "%u", state);
+    _event_notify(_ups.device, "shutdown_state", val);
   }
+}
 
-  start = end;
-  val = simple_strtoul(start, &end, 16);
+static void _ups_shutdown_policy(void) {
+  bool trigger;
 
-  size = (end - start) - 2;
+  if (!_ups.sdParams[UPS_SD_ENABLED] ||
+      _ups.sdState == UPS_SD_STATE_TRIGGERED) {
+    return;
+  }
 
-  if (reg > 255 || size > 8 || (size % 2) != 0) {
-    return -EINVAL;
+  // a backup trigger also fires on the below-threshold state
+  trigger = _ups.status >= _ups.sdParams[UPS_SD_TRIGGER] &&
+            _ups.status <= UPS_STATUS_BACKUP_LOW;
+  if (!trigger) {
+    if (_ups.sdState == UPS_SD_STATE_PENDING) {
+      _ups_shutdown_set_state(UPS_SD_STATE_IDLE);
+    }
+    return;
   }
 
-  if (_i2c_write(reg, size / 2, val, 0) < 0) {
-    return -EIO;
+  if (_ups.sdState == UPS_SD_STATE_IDLE) {
+    _ups.sdSince = ktime_get();
+    _ups_shutdown_set_state(UPS_SD_STATE_PENDING);
   }
 
-  return count;
+  if (ktime_ms_delta(ktime_get(), _ups.sdSince) <
+      _ups.sdParams[UPS_SD_GRACE] * 1000LL) {
+    return;
+  }
+
+  pr_notice(LOG_TAG "UPS state %u, shutting down\n", _ups.status);
+  _ups_shutdown_set_state(UPS_SD_STATE_TRIGGERED);
+  // power/down_enabled: cut power down_delay_config seconds from now
+  if (_i2c_write(I2C_REG_POWER_MAIN, 2, 1, 1) < 0) {
+    pr_err(LOG_TAG "failed to enable power cycle\n");
+  }
+  orderly_poweroff(true);
 }
 
-static ssize_t devAttrUpsBatteryV_show(struct device *dev,
-                                       struct device_attribute *attr,
-                                       char *buf) {
-  int32_t res;
-  res = devAttrI2c_show(dev, attr, buf);
+static void _ups_sample(struct SamplerBean *s) {
+  int64_t vals[3];
+  int64_t res;
+  uint8_t status;
+  bool backup;
+  bool changed;
+  int base;
+
+  base = I2C_EXPB_IDX_TO_REG_START(_ups.expbIdx);
+
+  if (_ups.type == X2_UPS) {
+    res = _i2c_read_block(base + I2C_REG_OFST_UPS_STATE, 3, 2, vals);
+    if (res == 0) {
+      _ups.chargerV = vals[1];
+      _ups.chargerI = vals[2];
+    }
+  } else {
+    res = _i2c_read(base + I2C_REG_OFST_UPS_STATE, 2);
+    vals[0] = res;
+  }
   if (res < 0) {
-    return res;
+    return;
   }
-  if (buf[0] == '1') {
-    return sprintf(buf, "24000\n");
-  } else {
-    return sprintf(buf, "12000\n");
+
+  status = vals[0] & 0xf;
+  backup = ((vals[0] >> 7) & 1) == 1;
+  changed = !_ups.valid || status != _ups.status || backup != _ups.backup;
+  _ups.status = status;
+  _ups.backup = backup;
+  _ups.valid = true;
+
+  if (changed) {
+    if (_ups.type == X2_UPS) {
+      res = _i2c_read(base + I2C_REG_OFST_UPS_CAPACITY, 2);
+      if (res >= 0) {
+        _ups.capacity = res;
+      }
+    }
+    if (_ups.mainsPsy != NULL) {
+      power_supply_changed(_ups.mainsPsy);
+    }
+    if (_ups.battPsy != NULL) {
+      power_supply_changed(_ups.battPsy);
+    }
+  }
+
+  if (_ups.type == X2_UPS) {
+    _ups_coulomb_update();
   }
+
+  _ups_shutdown_policy();
 }
 
-static ssize_t devAttrUpsBatteryV_store(struct device *dev,
-                                        struct device_attribute *attr,
-                                        const char *buf, size_t count) {
-  int ret;
-  long val;
-  char buf2[2];
-  ret = kstrtol(buf, 10, &val);
-  if (ret < 0) {
-    return -EINVAL;
+static int _ups_psy_status(void) {
+  switch (_ups.status) {
+    case 0:
+      return POWER_SUPPLY_STATUS_NOT_CHARGING;
+    case 4:
+      return POWER_SUPPLY_STATUS_CHARGING;
+    case 5:
+      return POWER_SUPPLY_STATUS_FULL;
+    case 6:
+      // fall through
+    case 7:
+      return POWER_SUPPLY_STATUS_DISCHARGING;
+    default:
+      return POWER_SUPPLY_STATUS_UNKNOWN;
   }
-  if (val == 12000) {
-    buf2[0] = '0';
-  } else if (val == 24000) {
-    buf2[0] = '1';
-  } else {
-    return -EINVAL;
+}
+
+static int _ups_psy_health(void) {
+  switch (_ups.status) {
+    case 8:
+      return POWER_SUPPLY_HEALTH_OVERVOLTAGE;
+    case 9:
+      return POWER_SUPPLY_HEALTH_DEAD;
+    case 10:
+      // fall through
+    case 11:
+      return POWER_SUPPLY_HEALTH_UNSPEC_FAILURE;
+    case 1:
+      // fall through
+    case 2:
+      return POWER_SUPPLY_HEALTH_UNKNOWN;
+    default:
+      return POWER_SUPPLY_HEALTH_GOOD;
   }
+}
 
-  buf2[1] = '\0';
-  ret = devAttrI2c_store(dev, attr, buf2, 1);
-  if (ret < 0) {
-    return ret;
+static int _ups_mains_get_property(struct power_supply *psy,
+                                   enum power_supply_property psp,
+                                   union power_supply_propval *val) {
+  if (!_ups.valid) {
+    return -ENODATA;
+  }
+  switch (psp) {
+    case POWER_SUPPLY_PROP_ONLINE:
+      val->intval = _ups.backup ? 0 : 1;
+      return 0;
+    default:
+      return -EINVAL;
   }
-  return count;
 }
 
-static ssize_t devAttrLm75a_show(struct device *dev,
-                                 struct device_attribute *attr, char *buf) {
-  int32_t res;
-  struct DeviceAttrBean *dab;
-  dab = container_of(attr, struct DeviceAttrBean, devAttr);
-  if (dab == NULL) {
-    return -EFAULT;
+static int _ups_batt_get_property(struct power_supply *psy,
+                                  enum power_supply_property psp,
+                                  union power_supply_propval *val) {
+  if (!_ups.valid) {
+    return -ENODATA;
+  }
+  switch (psp) {
+    case POWER_SUPPLY_PROP_STATUS:
+      val->intval = _ups_psy_status();
+      return 0;
+    case POWER_SUPPLY_PROP_HEALTH:
+      val->intval = _ups_psy_health();
+      return 0;
+    case POWER_SUPPLY_PROP_PRESENT:
+      val->intval = (_ups.status == 1 || _ups.status == 2) ? 0 : 1;
+      return 0;
+    case POWER_SUPPLY_PROP_CAPACITY_LEVEL:
+      if (_ups.status == 5) {
+        val->intval = POWER_SUPPLY_CAPACITY_LEVEL_FULL;
+      } else if (_ups.status == 7) {
+        val->intval = POWER_SUPPLY_CAPACITY_LEVEL_CRITICAL;
+      } else if (_ups.status == 4 || _ups.status == 6) {
+        val->intval = POWER_SUPPLY_CAPACITY_LEVEL_NORMAL;
+      } else {
+        val->intval = POWER_SUPPLY_CAPACITY_LEVEL_UNKNOWN;
+      }
+      return 0;
+    case POWER_SUPPLY_PROP_VOLTAGE_NOW:
+      // mV => µV
+      val->intval = _ups.chargerV * 1000;
+      return 0;
+    case POWER_SUPPLY_PROP_CURRENT_NOW:
+      // mA => µA
+      val->intval = _ups.chargerI * 1000;
+      return 0;
+    case POWER_SUPPLY_PROP_CAPACITY:
+      return _ups_soc(&val->intval);
+    case POWER_SUPPLY_PROP_TIME_TO_EMPTY_NOW:
+      return _ups_time_to_empty(&val->intval);
+    case POWER_SUPPLY_PROP_CHARGE_NOW:
+      if (!_ups.chargeValid) {
+        return -ENODATA;
+      }
+      // mA * ms => µAh
+      val->intval = div_s64(_ups.charge, 3600);
+      return 0;
+    case POWER_SUPPLY_PROP_CHARGE_FULL_DESIGN:
+      // mAh => µAh
+      val->intval = _ups.capacity * 1000;
+      return 0;
+    case POWER_SUPPLY_PROP_SCOPE:
+      val->intval = POWER_SUPPLY_SCOPE_SYSTEM;
+      return 0;
+    case POWER_SUPPLY_PROP_MODEL_NAME:
+      val->strval = _ups.type == X2_UPS ? "UPS" : "SuperCaps UPS";
+      return 0;
+    case POWER_SUPPLY_PROP_MANUFACTURER:
+      val->strval = "Sfera Labs";
+      return 0;
+    default:
+      return -EINVAL;
   }
+}
 
-  if (lm75a_i2c_client == NULL) {
-    return -ENODEV;
-  }
+static enum power_supply_property _upsMainsProps[] = {
+    POWER_SUPPLY_PROP_ONLINE,
+};
 
-  if (!_i2c_lock()) {
-    return -EBUSY;
-  }
+static enum power_supply_property _upsBattProps[] = {
+    POWER_SUPPLY_PROP_STATUS,
+    POWER_SUPPLY_PROP_HEALTH,
+    POWER_SUPPLY_PROP_PRESENT,
+    POWER_SUPPLY_PROP_CAPACITY_LEVEL,
+    POWER_SUPPLY_PROP_SCOPE,
+    POWER_SUPPLY_PROP_MODEL_NAME,
+    POWER_SUPPLY_PROP_MANUFACTURER,
+    POWER_SUPPLY_PROP_VOLTAGE_NOW,
+    POWER_SUPPLY_PROP_CURRENT_NOW,
+    POWER_SUPPLY_PROP_CHARGE_FULL_DESIGN,
+    POWER_SUPPLY_PROP_CHARGE_NOW,
+    POWER_SUPPLY_PROP_CAPACITY,
+    POWER_SUPPLY_PROP_TIME_TO_EMPTY_NOW,
+};
 
-  res = i2c_smbus_read_word_data(lm75a_i2c_client, dab->regSpecs.reg);
+// the SuperCaps UPS has no charger monitor nor capacity setting
+#define UPS_CAP_BATT_PROPS_NUM 7
 
-  _i2c_unlock();
+static const struct power_supply_desc _upsMainsDesc = {
+    .name = "stratopimax-mains",
+    .type = POWER_SUPPLY_TYPE_MAINS,
+    .properties = _upsMainsProps,
+    .num_properties = ARRAY_SIZE(_upsMainsProps),
+    .get_property = _ups_mains_get_property,
+};
 
-  if (res < 0) {
-    return res;
-  }
+static struct power_supply_desc _upsBattDesc = {
+    .name = "stratopimax-ups",
+    .type = POWER_SUPPLY_TYPE_BATTERY,
+    .properties = _upsBattProps,
+    .num_properties = ARRAY_SIZE(_upsBattProps),
+    .get_property = _ups_batt_get_property,
+};
 
-  res = ((res & 0xff) << 8) + ((res >> 8) & dab->regSpecs.mask);
-  res = ((int16_t)res) * 100 / 256;
+static char *_upsMainsSuppliedTo[] = {
+    "stratopimax-ups",
+};
 
-  return sprintf(buf, "%d\n", res);
+static void _ups_init(void) {
+  _sampler_init(&_ups.sampler, UPS_INTERVAL_DEFAULT_MSEC, _ups_sample);
 }
 
-static ssize_t devAttrLm75a_store(struct device *dev,
-                                  struct device_attribute *attr,
-                                  const char *buf, size_t count) {
-  int32_t res;
-  long temp;
-  struct DeviceAttrBean *dab;
-  dab = container_of(attr, struct DeviceAttrBean, devAttr);
-  if (dab == NULL) {
-    return -EFAULT;
-  }
+static void _ups_register(struct platform_device *pdev) {
+  struct power_supply_config cfg = {};
+  struct power_supply *psy;
 
-  if (lm75a_i2c_client == NULL) {
-    return -ENODEV;
+  _ups.expbIdx = _expb_find(devUpsExpbTypes);
+  if (_ups.expbIdx < 0) {
+    return;
   }
+  _ups.type = _expbs[_ups.expbIdx].type;
+  _ups.device = _expb_device(_ups.expbIdx, "ups");
 
-  res = kstrtol(buf, 10, &temp);
-  if (res < 0) {
-    return res;
+  // the battery UPS has no below-threshold state
+  if (_ups.type == X2_UPS) {
+    _ups.sdParams[UPS_SD_TRIGGER] = UPS_STATUS_BACKUP;
+  } else {
+    _ups.sdParams[UPS_SD_TRIGGER] = UPS_STATUS_BACKUP_LOW;
+    _upsBattDesc.num_properties = UPS_CAP_BATT_PROPS_NUM;
   }
-  if (temp > 12750) {
-    return -EINVAL;
+
+  cfg.supplied_to = _upsMainsSuppliedTo;
+  cfg.num_supplicants = ARRAY_SIZE(_upsMainsSuppliedTo);
+  psy = power_supply_register(&pdev->dev, &_upsMainsDesc, &cfg);
+  if (IS_ERR(psy)) {
+    pr_err(LOG_TAG "failed to register %s\n", _upsMainsDesc.name);
+  } else {
+    _ups.mainsPsy = psy;
   }
-  if (temp < -12800) {
-    return -EINVAL;
+
+  psy = power_supply_register(&pdev->dev, &_upsBattDesc, NULL);
+  if (IS_ERR(psy)) {
+    pr_err(LOG_TAG "failed to register %s\n", _upsBattDesc.name);
+  } else {
+    _ups.battPsy = psy;
   }
 
-  temp = temp * 256 / 100;
-  temp = ((temp & dab->regSpecs.mask) << 8) + ((temp >> 8) & 0xff);
+  _sampler_start(&_ups.sampler);
+}
 
-  if (!_i2c_lock()) {
-    return -EBUSY;
+static void _ups_unregister(void) {
+  _sampler_stop(&_ups.sampler);
+  if (_ups.battPsy != NULL) {
+    power_supply_unregister(_ups.battPsy);
+    _ups.battPsy = NULL;
   }
+  if (_ups.mainsPsy != NULL) {
+    power_supply_unregister(_ups.mainsPsy);
+    _ups.mainsPsy = NULL;
+  }
+}
 
-  res = i2c_smbus_write_word_data(lm75a_i2c_client, dab->regSpecs.reg, temp);
-
-  _i2c_unlock();
+static ssize_t devAttrUpsShutdown_show(struct device *dev,
+                                       struct device_attribute *attr,
+                                       char *buf) {
+  struct DeviceAttrBean *dab;
 
-  if (res < 0) {
-    return res;
+  dab = container_of(attr, struct DeviceAttrBean, devAttr);
+  if (dab->regSpecs.reg == UPS_SD_PARAMS_NUM) {
+    return sprintf(buf, "%u\n", _ups.sdState);
   }
-
-  return count;
+  if (dab->regSpecs.reg > UPS_SD_PARAMS_NUM) {
+    return -EFAULT;
+  }
+  return sprintf(buf, "%u\n", _ups.sdParams[dab->regSpecs.reg]);
 }
 
-static ssize_t devAttrBlink_store(struct device *dev,
-                                  struct device_attribute *attr,
-                                  const char *buf, size_t count) {
+static ssize_t devAttrUpsShutdown_store(struct device *dev,
+                                        struct device_attribute *attr,
+                                        const char *buf, size_t count) {
   struct DeviceAttrBean *dab;
-  int64_t res;
-  uint16_t on = 0;
-  uint16_t off = 0;
-  uint16_t rep = 0;
-  char *end = NULL;
+  unsigned int val;
+  int ret;
 
   dab = container_of(attr, struct DeviceAttrBean, devAttr);
+  if (dab->regSpecs.reg >= UPS_SD_PARAMS_NUM) {
+    return -EFAULT;
+  }
+  ret = kstrtouint(buf, 10, &val);
+  if (ret < 0) {
+    return ret;
+  }
 
-  on = simple_strtoul(buf, &end, 10);
-  if (++end < buf + count) {
-    off = simple_strtoul(end, &end, 10);
-    if (++end < buf + count) {
-      rep = simple_strtoul(end, NULL, 10);
-    }
+  switch (dab->regSpecs.reg) {
+    case UPS_SD_ENABLED:
+      if (val > 1) {
+        return -EINVAL;
+      }
+      if (!val && _ups.sdState == UPS_SD_STATE_PENDING) {
+        _ups_shutdown_set_state(UPS_SD_STATE_IDLE);
+      }
+      break;
+    case UPS_SD_TRIGGER:
+      if (val != UPS_STATUS_BACKUP &&
+          (val != UPS_STATUS_BACKUP_LOW || _ups.type == X2_UPS)) {
+        return -EINVAL;
+      }
+      break;
+    default:
+      if (val > 0xffff) {
+        return -EINVAL;
+      }
+      break;
   }
 
-  res = _i2c_write_segment(dab->regSpecs.reg, dab->regSpecs.len,
-                           dab->regSpecs.mask, dab->regSpecs.shift, on, true);
-  if (res > 0) {
-    res =
-        _i2c_write_segment(dab->regSpecs.reg + 1, dab->regSpecs.len,
-                           dab->regSpecs.mask, dab->regSpecs.shift, off, true);
-    if (res > 0) {
-      res = _i2c_write_segment(dab->regSpecs.reg + 2, dab->regSpecs.len,
-                               dab->regSpecs.mask, dab->regSpecs.shift, rep,
-                               true);
-    }
+  _ups.sdParams[dab->regSpecs.reg] = val;
+  return count;
+}
+
+static ssize_t devAttrUpsSoc_show(struct device *dev,
+                                  struct device_attribute *attr, char *buf) {
+  int val;
+  int res;
+
+  res = _ups_soc(&val);
+  if (res < 0) {
+    return res;
   }
+  return sprintf(buf, "%d\n", val);
+}
+
+static ssize_t devAttrUpsTimeToEmpty_show(struct device *dev,
+                                          struct device_attribute *attr,
+                                          char *buf) {
+  int val;
+  int res;
 
+  res = _ups_time_to_empty(&val);
   if (res < 0) {
     return res;
   }
+  return sprintf(buf, "%d\n", val);
+}
+
+static ssize_t devAttrUpsMonitorInterval_show(struct device *dev,
+                                              struct device_attribute *attr,
+                                              char *buf) {
+  return sprintf(buf, "%u\n", _ups.sampler.interval_ms);
+}
+
+static ssize_t devAttrUpsMonitorInterval_store(struct device *dev,
+                                               struct device_attribute *attr,
+                                               const char *buf,
+                                               size_t count) {
+  unsigned int val;
+  int ret;
 
+  ret = kstrtouint(buf, 10, &val);
+  if (ret < 0) {
+    return ret;
+  }
+  if (val < UPS_INTERVAL_MIN_MSEC) {
+    return -EINVAL;
+  }
+  _sampler_set_interval(&_ups.sampler, val);
   return count;
 }
 
@@ -4910,26 +6170,36 @@ static int _i2c_probe(struct i2c_client *client,
 #endif
   uint8_t i;
   int64_t res;
+  int64_t vals[8];
   bool ok;
 
   if (strcmp("stratopimax-rp2", client->name) == 0) {
     rp2_i2c_client = client;
 
-    ok = true;
-    for (i = 0; i < 4; i++) {
-      res = _i2c_read(I2C_REG_EXPB_TYPE_S1 + i, 2);
-      if (res < 0) {
-        ok = false;
-        break;
+    // boards inventory, read once: types and serials as two register runs
+    ok = _i2c_read_block(I2C_REG_EXPB_TYPE_S1, 4, 2, vals) == 0;
+    if (ok) {
+      for (i = 0; i < 4; i++) {
+        _expbs[i].type = vals[i];
+        pr_info(LOG_TAG "Exp %d type=%d\n", (i + 1), _expbs[i].type);
+      }
+      if (_i2c_read_block(I2C_REG_EXPB_SERIAL_S1_LOW, 8, 2, vals) == 0) {
+        for (i = 0; i < 4; i++) {
+          _expbs[i].serial = ((uint32_t)vals[i * 2 + 1] << 16) |
+                             (uint32_t)vals[i * 2];
+          _expbs[i].serialValid = true;
+        }
+      } else {
+        pr_err(LOG_TAG "error reading expansion boards serials\n");
       }
-      _expbs[i].type = res;
-      pr_info(LOG_TAG "Exp %d type=%d\n", (i + 1), _expbs[i].type);
     }
 
     if (ok) {
       _rp2_probed = true;
+      complete_all(&_rp2ProbeDone);
     } else {
       rp2_i2c_client = NULL;
+      complete_all(&_rp2ProbeDone);
       return -1;
     }
 
@@ -4993,139 +6263,281 @@ static struct i2c_driver _i2c_driver = {
     .id_table = _i2c_id,
 };
 
-static int _device_add(struct platform_device *pdev, struct DeviceBean *db,
-                       int8_t expbIdx) {
-  struct device *dev;
-  struct DeviceData *data = NULL;
-  struct DeviceData **pData;
+static bool _device_bean_applies(struct DeviceBean *db, int8_t expbIdx) {
+  int ti;
+
+  if (db->expbTypes == NULL) {
+    return expbIdx < 0;
+  }
+  if (expbIdx < 0) {
+    return false;
+  }
+  for (ti = 0; db->expbTypes[ti] != 0; ti++) {
+    if (_expbs[expbIdx].type == db->expbTypes[ti]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static umode_t _device_attr_is_visible(struct kobject *kobj,
+                                       struct attribute *attr, int n) {
+  struct DeviceAttrBean *dab;
+  struct DeviceData *data;
+
+  dab = container_of(attr, struct DeviceAttrBean, devAttr.attr);
+  data = dev_get_drvdata(kobj_to_dev(kobj));
+  if (!_device_bean_applies(dab->deviceBean,
+                            data == NULL ? -1 : data->expbIdx)) {
+    return 0;
+  }
+  return attr->mode;
+}
+
+/**
+ * Builds the attribute group of a DeviceBean, expanding the bit-mapped
+ * files. Done once per bean, the group is shared by all the devices (e.g.
+ * slots) it is created for.
+ */
+static int _device_group_build(struct platform_device *pdev,
+                               struct DeviceBean *db) {
+  struct attribute **attrs;
   struct DeviceAttrBean *dab;
   struct DeviceAttrBean *dabM;
-  char fileNameBuf[32];
-  int fi, ai;
+  int fi, ai, n;
 
-  if (db->expbTypes != NULL) {
-    data = devm_kzalloc(&pdev->dev, sizeof(struct DeviceData), GFP_KERNEL);
-    if (!data) {
+  n = 0;
+  for (ai = 0; db->devAttrBeans[ai].devAttr.attr.name != NULL; ai++) {
+    n += max_t(int, db->devAttrBeans[ai].bitMapLen, 1);
+  }
+  attrs = devm_kcalloc(&pdev->dev, n + 1, sizeof(*attrs), GFP_KERNEL);
+  if (!attrs) {
+    return -ENOMEM;
+  }
+
+  n = 0;
+  for (ai = 0; db->devAttrBeans[ai].devAttr.attr.name != NULL; ai++) {
+    dab = &db->devAttrBeans[ai];
+    dab->deviceBean = db;
+    if (dab->bitMapLen == 0) {
+      attrs[n++] = &dab->devAttr.attr;
+      continue;
+    }
+    dabM = devm_kcalloc(&pdev->dev, dab->bitMapLen, sizeof(*dabM),
+                        GFP_KERNEL);
+    if (!dabM) {
       return -ENOMEM;
     }
+    for (fi = 0; fi < dab->bitMapLen; fi++) {
+      memcpy(&dabM[fi], dab, sizeof(struct DeviceAttrBean));
+      dabM[fi].regSpecs.shift *= fi;
+      dabM[fi].regSpecs.shift += dab->bitMapStart;
+      dabM[fi].devAttr.attr.name = devm_kasprintf(
+          &pdev->dev, GFP_KERNEL, dab->devAttr.attr.name, (fi + 1));
+      if (!dabM[fi].devAttr.attr.name) {
+        return -ENOMEM;
+      }
+      attrs[n++] = &dabM[fi].devAttr.attr;
+    }
   }
-  dev = class_find_device_by_name(_pDeviceClass, db->name);
-  if (!dev) {
-    dev = device_create(_pDeviceClass, NULL, 0, data, db->name, (expbIdx + 1));
-    if (IS_ERR(dev)) {
-      pr_err(LOG_TAG "failed to create device '%s' s=%d\n", db->name,
-             (expbIdx + 1));
-      return -1;
+
+  db->group.attrs = attrs;
+  db->group.is_visible = _device_attr_is_visible;
+  return 0;
+}
+
+/**
+ * Creates the device of devices[di] for the given slot (-1 if not an
+ * expansion board device) with the groups of all the beans sharing its name,
+ * so that all the files are in place when the device is announced.
+ */
+static int _device_add(struct platform_device *pdev, int di, int8_t expbIdx) {
+  const struct attribute_group **groups;
+  struct DeviceBean *db = &devices[di];
+  struct DeviceData *data = NULL;
+  struct DeviceData **pData;
+  struct device *dev;
+  int dj, n;
+
+  for (dj = 0; dj < di; dj++) {
+    if (strcmp(devices[dj].name, db->name) == 0 &&
+        _device_bean_applies(&devices[dj], expbIdx)) {
+      // already created with the groups of this bean
+      return 0;
     }
   }
-  db->device = dev;
-  if (data != NULL) {
+
+  n = 0;
+  for (dj = di; devices[dj].name != NULL; dj++) {
+    if (strcmp(devices[dj].name, db->name) == 0) {
+      n++;
+    }
+  }
+  groups = devm_kcalloc(&pdev->dev, n + 1, sizeof(*groups), GFP_KERNEL);
+  if (!groups) {
+    return -ENOMEM;
+  }
+  n = 0;
+  for (dj = di; devices[dj].name != NULL; dj++) {
+    if (strcmp(devices[dj].name, db->name) == 0) {
+      groups[n++] = &devices[dj].group;
+    }
+  }
+
+  if (expbIdx >= 0) {
+    data = devm_kzalloc(&pdev->dev, sizeof(struct DeviceData), GFP_KERNEL);
+    if (!data) {
+      return -ENOMEM;
+    }
     data->expbIdx = expbIdx;
-    data->device = db->device;
+  }
+
+  dev = device_create_with_groups(_pDeviceClass, NULL, 0, data, groups,
+                                  db->name, (expbIdx + 1));
+  if (IS_ERR(dev)) {
+    pr_err(LOG_TAG "failed to create device '%s' s=%d\n", db->name,
+           (expbIdx + 1));
+    return -1;
+  }
+
+  if (data == NULL) {
+    db->device = dev;
+  } else {
+    data->device = dev;
     pData = &_expbs[expbIdx].data;
     while (*pData != NULL) {
       pData = &(*pData)->next;
     }
     *pData = data;
   }
+  return 0;
+}
 
-  ai = 0;
-  while (db->devAttrBeans[ai].devAttr.attr.name != NULL) {
-    dab = &db->devAttrBeans[ai];
-    fi = 0;
-    do {
-      if (dab->bitMapLen > 0) {
-        dabM =
-            devm_kzalloc(&pdev->dev, sizeof(struct DeviceAttrBean), GFP_KERNEL);
-        if (!dabM) {
-          return -ENOMEM;
-        }
-        memcpy(dabM, dab, sizeof(struct DeviceAttrBean));
-        dabM->regSpecs.shift *= fi;
-        dabM->regSpecs.shift += dab->bitMapStart;
-        dabM->regSpecsStore.shift *= fi;
-        dabM->regSpecsStore.shift += dab->bitMapStart;
-        sprintf(fileNameBuf, dab->devAttr.attr.name, (fi + 1));
-        dabM->devAttr.attr.name = fileNameBuf;
-      } else {
-        dabM = dab;
-      }
+// undoes stratopimax_init_async() and what its devices started; safe to
+// call again, the watchdog and the RP2 driver stay up
+static void cleanup_async(void) {
+  struct DeviceBean *db;
+  struct DeviceData *data;
+  int di, ei;
 
-      if (device_create_file(dev, &dabM->devAttr)) {
-        pr_err(LOG_TAG "failed to create device file '%s/%s' s=%d\n", db->name,
-               dabM->devAttr.attr.name, (expbIdx + 1));
-        return -1;
+  mutex_lock(&_pid_mtx);
+  for (ei = 0; ei < 4; ei++) {
+    _pid_stop(&_pidLoops[ei]);
+  }
+  mutex_unlock(&_pid_mtx);
+  _pwr_notify_unregister();
+  mutex_lock(&_khb.lock);
+  _khb_stop();
+  mutex_unlock(&_khb.lock);
+  _ups_unregister();
+  _fan_unregister();
+  _sampler_stop(&_energy.sampler);
+  _sampler_stop(&_accel.sampler);
+  _button_unregister();
+  _led_unregister();
+  _gpiochip_unregister();
+  _hwmon_unregister();
+  _ain_sync_stop();
+  _ain_stop();
+
+  for (di = 0; devices[di].name != NULL; di++) {
+    db = &devices[di];
+    if (db->device != NULL) {
+      device_unregister(db->device);
+      db->device = NULL;
+    }
+  }
+  for (ei = 0; ei < 4; ei++) {
+    for (data = _expbs[ei].data; data != NULL; data = data->next) {
+      if (data->device != NULL) {
+        device_unregister(data->device);
+        data->device = NULL;
       }
-      fi++;
-    } while (fi < dab->bitMapLen);
-    ai++;
+    }
+    _expbs[ei].data = NULL;
   }
-  return 0;
+
+  gpioFree(&gpioSdRoute);
 }
 
-static void _device_remove_files(struct DeviceBean *db, struct device *dev) {
-  struct DeviceAttrBean *dab;
-  int ai;
+static void cleanup(void) {
+  int i;
 
-  ai = 0;
-  while (db->devAttrBeans[ai].devAttr.attr.name != NULL) {
-    dab = &db->devAttrBeans[ai];
-    device_remove_file(dev, &dab->devAttr);
-    ai++;
+  if (_pDeviceClass != NULL && !IS_ERR(_pDeviceClass)) {
+    cleanup_async();
+    _wdt_unregister();
+
+    i2c_del_driver(&_i2c_driver);
+
+    mutex_destroy(&_i2c_mtx);
+    mutex_destroy(&_pid_mtx);
+    mutex_destroy(&_fan.lock);
+    mutex_destroy(&_khb.lock);
+    mutex_destroy(&_khb.pathLock);
+    mutex_destroy(&_accel.lock);
+    mutex_destroy(&_gpioChip.lock);
+    mutex_destroy(&_ainSync.lock);
+    for (i = 0; i < 4; i++) {
+      mutex_destroy(&_ainBoards[i].lock);
+    }
+
+    class_destroy(_pDeviceClass);
+    _pDeviceClass = NULL;
   }
-  device_destroy(_pDeviceClass, 0);
 }
 
-static void cleanup(void) {
+static void stratopimax_init_async(void *arg, async_cookie_t cookie) {
+  struct platform_device *pdev = arg;
   struct DeviceBean *db;
-  struct DeviceData *data;
-  int di, ei, ti;
+  int di, ei;
 
-  if (_pDeviceClass != NULL && !IS_ERR(_pDeviceClass)) {
-    di = 0;
-    while (devices[di].name != NULL) {
-      db = &devices[di];
+  _ain_sync_register();
+  _hwmon_register(pdev);
+  _fan_register();
+  _sampler_start(&_energy.sampler);
+  _button_register(pdev);
+  _led_register(pdev);
+  _pwr_notify_register();
 
-      if (db->device != NULL && !IS_ERR(db->device)) {
-        if (db->expbTypes == NULL) {
-          _device_remove_files(db, db->device);
-        } else {
-          ti = 0;
-          while (db->expbTypes[ti] != 0) {
-            for (ei = 0; ei < 4; ei++) {
-              if (_expbs[ei].type == db->expbTypes[ti]) {
-                data = _expbs[ei].data;
-                while (data != NULL) {
-                  if (data->device != NULL) {
-                    _device_remove_files(db, data->device);
-                    data->device = NULL;
-                    break;
-                  }
-                  data = data->next;
-                }
-              }
-            }
-            ti++;
-          }
+  if (gpioInit(&gpioSdRoute)) {
+    pr_err(LOG_TAG "error setting up GPIO %s\n", gpioSdRoute.name);
+    goto fail;
+  }
+
+  for (di = 0; devices[di].name != NULL; di++) {
+    if (_device_group_build(pdev, &devices[di])) {
+      goto fail;
+    }
+  }
+
+  for (di = 0; devices[di].name != NULL; di++) {
+    db = &devices[di];
+    if (db->expbTypes == NULL) {
+      if (_device_add(pdev, di, -1)) {
+        goto fail;
+      }
+    } else {
+      for (ei = 0; ei < 4; ei++) {
+        if (_device_bean_applies(db, ei) && _device_add(pdev, di, ei)) {
+          goto fail;
         }
       }
-      di++;
     }
+  }
 
-    gpioFree(&gpioSdRoute);
-
-    i2c_del_driver(&_i2c_driver);
+  _ups_register(pdev);
+  _gpiochip_register(pdev);
 
-    mutex_destroy(&_i2c_mtx);
+  pr_info(LOG_TAG "ready\n");
+  return;
 
-    class_destroy(_pDeviceClass);
-  }
+fail:
+  // the probe already succeeded: keep the watchdog running
+  pr_err(LOG_TAG "init failed\n");
+  cleanup_async();
 }
 
 static int stratopimax_init(struct platform_device *pdev) {
-  struct DeviceBean *db;
-  int i, di, ti, ei;
-
   pr_info(LOG_TAG "init\n");
 
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 5, 0)
@@ -5139,50 +6551,34 @@ static int stratopimax_init(struct platform_device *pdev) {
   }
 
   mutex_init(&_i2c_mtx);
+  mutex_init(&_pid_mtx);
+  _pid_init();
+  _hwmon_init();
+  _fan_init();
+  _khb_init();
+  _ups_init();
+  _energy_init();
+  _accel_init();
+  _button_init();
+  _gpiochip_init();
+  _ain_init();
+  _ain_sync_init();
+  init_completion(&_rp2ProbeDone);
   i2c_add_driver(&_i2c_driver);
   gpioSetPlatformDev(pdev);
 
-  for (i = 0; i < 50; i++) {
-    if (_rp2_probed) {
-      break;
-    }
-    msleep(50);
-  }
+  // completed by _i2c_probe(), normally already done by i2c_add_driver()
+  wait_for_completion_timeout(&_rp2ProbeDone,
+                              msecs_to_jiffies(RP2_PROBE_TIMEOUT_MSEC));
 
   if (!_rp2_probed) {
     pr_err(LOG_TAG "RP probing failed\n");
     goto fail;
   }
 
-  if (gpioInit(&gpioSdRoute)) {
-    pr_err(LOG_TAG "error setting up GPIO %s\n", gpioSdRoute.name);
-    goto fail;
-  }
-
-  di = 0;
-  while (devices[di].name != NULL) {
-    db = &devices[di];
-    if (db->expbTypes == NULL) {
-      if (_device_add(pdev, db, -1)) {
-        goto fail;
-      }
-    } else {
-      ti = 0;
-      while (db->expbTypes[ti] != 0) {
-        for (ei = 0; ei < 4; ei++) {
-          if (_expbs[ei].type == db->expbTypes[ti]) {
-            if (_device_add(pdev, db, ei)) {
-              goto fail;
-            }
-          }
-        }
-        ti++;
-      }
-    }
-    di++;
-  }
-
-  pr_info(LOG_TAG "ready\n");
+  // the watchdog is fed as early as possible, the rest is set up async
+  _wdt_register(pdev);
+  async_schedule_domain(stratopimax_init_async, pdev, &_initDomain);
 
   return 0;
 
@@ -5197,6 +6593,7 @@ static void stratopimax_exit(struct platform_device *pdev) {
 #else
 static int stratopimax_exit(struct platform_device *pdev) {
 #endif
+  async_synchronize_full_domain(&_initDomain);
   cleanup();
   pr_info(LOG_TAG "exit\n");
 #if LINUX_VERSION_CODE < KERNEL_VERSION(6, 12, 0)